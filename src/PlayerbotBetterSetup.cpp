@@ -10,6 +10,8 @@
 #include "DatabaseEnv.h"
 #include "DBCStores.h"
 #include "Item.h"
+#include "Log.h"
+#include "ObjectAccessor.h"
 #include "ObjectMgr.h"
 #include "Pet.h"
 #include "Player.h"
@@ -33,13 +35,21 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bitset>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <deque>
 #include <limits>
+#include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -57,6 +67,7 @@ namespace
 constexpr char const* CONF_SPEC_ENABLE = "PlayerbotBetterSetup.Spec.Enable";
 constexpr char const* CONF_REQUIRE_MASTER_CONTROL = "PlayerbotBetterSetup.Spec.RequireMasterControl";
 constexpr char const* CONF_SHOW_SPEC_LIST_ON_EMPTY = "PlayerbotBetterSetup.Spec.ShowSpecListOnEmpty";
+constexpr char const* CONF_QUIET_SPELL_LEARN = "PlayerbotBetterSetup.Spec.QuietSpellLearn";
 constexpr char const* CONF_AUTO_GEAR_RNDBOTS = "PlayerbotBetterSetup.Spec.AutoGearRndBots";
 constexpr char const* CONF_AUTO_GEAR_ALTBOTS = "PlayerbotBetterSetup.Spec.AutoGearAltBots";
 constexpr char const* CONF_GEAR_MODE_RNDBOTS = "PlayerbotBetterSetup.Spec.GearModeRndBots";
@@ -66,7 +77,8 @@ constexpr char const* CONF_GEAR_RATIO_ALTBOTS = "PlayerbotBetterSetup.Spec.GearM
 constexpr char const* CONF_EXPANSION_SOURCE = "PlayerbotBetterSetup.Spec.ExpansionSource";
 constexpr char const* CONF_GEAR_VALIDATION_LOWER_RATIO = "PlayerbotBetterSetup.Spec.GearValidationLowerRatio";
 constexpr char const* CONF_GEAR_VALIDATION_UPPER_RATIO = "PlayerbotBetterSetup.Spec.GearValidationUpperRatio";
-constexpr char const* CONF_GEAR_RETRY_COUNT = "PlayerbotBetterSetup.Spec.GearRetryCount";
+constexpr char const* CONF_GEAR_SCORE_CACHE_ENTRIES = "PlayerbotBetterSetup.Spec.GearScoreCacheEntries";
+constexpr char const* CONF_GEAR_PLAN_CACHE_ENTRIES = "PlayerbotBetterSetup.Spec.GearPlanCacheEntries";
 constexpr char const* CONF_GEAR_QUALITY_CAP_RATIO_MODE = "PlayerbotBetterSetup.Spec.GearQualityCapRatioMode";
 constexpr char const* CONF_GEAR_QUALITY_CAP_TOP_FOR_LEVEL = "PlayerbotBetterSetup.Spec.GearQualityCapTopForLevel";
 constexpr char const* CONF_SPECPLAYER_MIN_SECURITY = "PlayerbotBetterSetup.SpecPlayer.MinSecurityLevel";
@@ -86,13 +98,17 @@ constexpr char const* CONF_SPECPLAYER_POST_PET = "PlayerbotBetterSetup.SpecPlaye
 constexpr char const* CONF_SPECPLAYER_POST_PET_TALENTS = "PlayerbotBetterSetup.SpecPlayer.PostPetTalents";
 constexpr char const* CONF_SPECPLAYER_TARGET_AVERAGE_ILVL_60 = "PlayerbotBetterSetup.SpecPlayer.TargetAverageIlvl60";
 constexpr char const* CONF_SPECPLAYER_TARGET_AVERAGE_ILVL_70 = "PlayerbotBetterSetup.SpecPlayer.TargetAverageIlvl70";
-constexpr char const* CONF_SPECPLAYER_GEAR_RETRY_COUNT = "PlayerbotBetterSetup.SpecPlayer.GearRetryCount";
 constexpr char const* CONF_SPECPLAYER_GEAR_QUALITY_CAP = "PlayerbotBetterSetup.SpecPlayer.GearQualityCap";
 constexpr char const* CONF_SPECPLAYER_EXCLUDE_QUEST_REWARD_ITEMS = "PlayerbotBetterSetup.SpecPlayer.ExcludeQuestRewardItems";
 constexpr char const* CONF_SPECPLAYER_ENFORCE_UNIQUE_RING_TRINKET_PAIRS =
     "PlayerbotBetterSetup.SpecPlayer.EnforceUniqueRingTrinketPairs";
 constexpr char const* CONF_SPECPLAYER_GEAR_LEVEL_SEARCH_WINDOW = "PlayerbotBetterSetup.SpecPlayer.GearLevelSearchWindow";
 constexpr char const* CONF_LOGIN_DIAGNOSTICS_ENABLE = "PlayerbotBetterSetup.LoginDiagnostics.Enable";
+constexpr char const* CONF_SELECTORS_VERIFY_COMPILED = "PlayerbotBetterSetup.Selectors.VerifyCompiled";
+constexpr char const* CONF_SLOW_COMMAND_THRESHOLD_MS = "PlayerbotBetterSetup.Diagnostics.SlowCommandThresholdMs";
+constexpr char const* CONF_VERIFY_STATIC_EQUIP = "PlayerbotBetterSetup.Diagnostics.VerifyStaticEquip";
+constexpr char const* CONF_SCHEDULER_ENABLE = "PlayerbotBetterSetup.Scheduler.Enable";
+constexpr char const* CONF_SCHEDULER_TICK_BUDGET_MS = "PlayerbotBetterSetup.Scheduler.TickBudgetMs";
 constexpr char const* OFFLINE_SPECPLAYER_SOURCE = "mod-playerbot-bettersetup-specplayer";
 constexpr char const* PET_SPEC_SOURCE = "mod-playerbot-bettersetup-petspec";
 constexpr char const* MANUAL_SPEC_SOURCE = "mod-playerbot-bettersetup-manualspec";
@@ -129,12 +145,20 @@ std::string TrimCopy(std::string value)
     return value;
 }
 
-bool StartsWith(std::string const& value, std::string const& prefix)
+std::string_view TrimView(std::string_view value)
 {
-    return value.size() >= prefix.size() && value.compare(0, prefix.size(), prefix) == 0;
+    auto const isSpace = [](unsigned char c) { return std::isspace(c) != 0; };
+
+    while (!value.empty() && isSpace(value.front()))
+        value.remove_prefix(1);
+
+    while (!value.empty() && isSpace(value.back()))
+        value.remove_suffix(1);
+
+    return value;
 }
 
-std::string NormalizeToken(std::string const& input)
+std::string NormalizeToken(std::string_view input)
 {
     std::string out;
     out.reserve(input.size());
@@ -148,18 +172,189 @@ std::string NormalizeToken(std::string const& input)
     return out;
 }
 
-std::vector<std::string> SplitCommands(std::string const& input, std::string const& separator)
+/* NormalizeToken into a stack buffer, for catalog lookups.
+ * Nothing in the catalogs is longer than the buffer, so input that does not
+ * fit cannot match anything and simply reports a miss.
+ */
+
+class NormalizedToken
+{
+public:
+    explicit NormalizedToken(std::string_view input)
+    {
+        for (unsigned char c : input)
+        {
+            if (!std::isalnum(c))
+                continue;
+
+            if (size == buffer.size())
+            {
+                overflow = true;
+                return;
+            }
+
+            buffer[size++] = static_cast<char>(std::tolower(c));
+        }
+    }
+
+    bool Valid() const { return !overflow; }
+    std::string_view View() const { return std::string_view(buffer.data(), size); }
+
+private:
+    std::array<char, 32> buffer = {};
+    size_t size = 0;
+    bool overflow = false;
+};
+
+/* Compile-time perfect hash for small token catalogs.
+ * Keys are (scope, normalized token); scope is the class id for spec aliases
+ * and 0 elsewhere. Keys are spread over N buckets, and each bucket gets the
+ * first seed that drops all of its keys into free slots, so a lookup is one
+ * hash for the bucket, one for the slot, and one compare. A duplicate key or
+ * an unplaceable bucket fails the build instead of a lookup.
+ */
+
+template <typename Value>
+struct TokenCatalogEntry
+{
+    uint8 scope;
+    std::string_view token;
+    Value value;
+};
+
+constexpr uint32 HashCatalogToken(uint8 scope, std::string_view token, uint32 seed)
+{
+    uint32 hash = 2166136261u ^ (seed * 16777619u);
+    hash = (hash ^ scope) * 16777619u;
+    for (char c : token)
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+constexpr size_t GetTokenCatalogSlotCount(size_t entries)
+{
+    size_t slots = 1;
+    while (slots < entries * 2)
+        slots <<= 1;
+
+    return slots;
+}
+
+template <typename Value, size_t N>
+class PerfectTokenTable
+{
+public:
+    static constexpr size_t SLOTS = GetTokenCatalogSlotCount(N);
+    static constexpr uint16 EMPTY_SLOT = 0xFFFF;
+
+    constexpr explicit PerfectTokenTable(std::array<TokenCatalogEntry<Value>, N> const& catalog)
+        : entries(catalog), seeds(), slots()
+    {
+        for (size_t slot = 0; slot < SLOTS; ++slot)
+            slots[slot] = EMPTY_SLOT;
+
+        std::array<uint16, N> bucketOf = {};
+        std::array<uint16, N> bucketSize = {};
+        size_t largestBucket = 0;
+
+        for (size_t index = 0; index < N; ++index)
+        {
+            for (size_t other = 0; other < index; ++other)
+            {
+                if (catalog[other].scope == catalog[index].scope && catalog[other].token == catalog[index].token)
+                    throw "duplicate token in catalog";
+            }
+
+            bucketOf[index] = static_cast<uint16>(HashCatalogToken(catalog[index].scope, catalog[index].token, 0) % N);
+            largestBucket = std::max<size_t>(largestBucket, ++bucketSize[bucketOf[index]]);
+        }
+
+        /* Biggest buckets first, while the table still has room to move. */
+
+        for (size_t size = largestBucket; size > 0; --size)
+        {
+            for (size_t bucket = 0; bucket < N; ++bucket)
+            {
+                if (bucketSize[bucket] != size)
+                    continue;
+
+                for (uint32 seed = 1;; ++seed)
+                {
+                    if (seed > 100000)
+                        throw "no perfect hash seed for catalog bucket";
+
+                    std::array<uint16, N> placed = {};
+                    size_t placedCount = 0;
+                    bool fits = true;
+
+                    for (size_t index = 0; index < N && fits; ++index)
+                    {
+                        if (bucketOf[index] != bucket)
+                            continue;
+
+                        uint16 const slot = static_cast<uint16>(HashCatalogToken(catalog[index].scope, catalog[index].token, seed) % SLOTS);
+                        fits = slots[slot] == EMPTY_SLOT;
+
+                        for (size_t placedIndex = 0; placedIndex < placedCount && fits; ++placedIndex)
+                            fits = placed[placedIndex] != slot;
+
+                        placed[placedCount++] = slot;
+                    }
+
+                    if (!fits)
+                        continue;
+
+                    size_t placedIndex = 0;
+                    for (size_t index = 0; index < N; ++index)
+                    {
+                        if (bucketOf[index] == bucket)
+                            slots[placed[placedIndex++]] = static_cast<uint16>(index);
+                    }
+
+                    seeds[bucket] = seed;
+                    break;
+                }
+            }
+        }
+    }
+
+    constexpr Value const* Find(uint8 scope, std::string_view token) const
+    {
+        uint32 const bucket = HashCatalogToken(scope, token, 0) % N;
+        uint16 const index = slots[HashCatalogToken(scope, token, seeds[bucket]) % SLOTS];
+        if (index == EMPTY_SLOT || entries[index].scope != scope || entries[index].token != token)
+            return nullptr;
+
+        return &entries[index].value;
+    }
+
+    Value const* Find(uint8 scope, NormalizedToken const& token) const
+    {
+        return token.Valid() ? Find(scope, token.View()) : nullptr;
+    }
+
+private:
+    std::array<TokenCatalogEntry<Value>, N> entries;
+    std::array<uint32, N> seeds;
+    std::array<uint16, SLOTS> slots;
+};
+
+std::vector<std::string_view> SplitCommands(std::string_view input, std::string_view separator)
 {
     if (separator.empty())
         return { input };
 
-    std::vector<std::string> commands;
+    std::vector<std::string_view> commands;
     size_t begin = 0;
 
     while (begin <= input.size())
     {
         size_t pos = input.find(separator, begin);
-        if (pos == std::string::npos)
+        if (pos == std::string_view::npos)
         {
             commands.push_back(input.substr(begin));
             break;
@@ -184,21 +379,32 @@ std::vector<std::string> SplitWords(std::string const& input)
     return tokens;
 }
 
-std::string JoinWords(std::vector<std::string> const& words, size_t from)
+/* Same split as SplitWords, but the words stay inside the caller's buffer. */
+
+std::vector<std::string_view> SplitWordViews(std::string_view input)
 {
-    if (from >= words.size())
-        return "";
+    auto const isSpace = [](unsigned char c) { return std::isspace(c) != 0; };
 
-    std::ostringstream out;
-    for (size_t i = from; i < words.size(); ++i)
+    std::vector<std::string_view> words;
+    size_t pos = 0;
+
+    while (pos < input.size())
     {
-        if (i != from)
-            out << ' ';
+        while (pos < input.size() && isSpace(input[pos]))
+            ++pos;
 
-        out << words[i];
+        if (pos == input.size())
+            break;
+
+        size_t end = pos;
+        while (end < input.size() && !isSpace(input[end]))
+            ++end;
+
+        words.push_back(input.substr(pos, end - pos));
+        pos = end;
     }
 
-    return out.str();
+    return words;
 }
 
 using ProfessionPair = std::pair<uint16, uint16>;
@@ -312,12 +518,9 @@ struct RidingStateSnapshot
 
 using EpicClassMountSpellSnapshot = std::array<bool, 3>;
 
-bool IsBlockedEpicClassMountSpell(Player* bot, uint32 spellId)
+bool IsBlockedEpicClassMountSpellForClass(uint8 classId, uint32 spellId)
 {
-    if (!bot)
-        return false;
-
-    switch (bot->getClass())
+    switch (classId)
     {
         case CLASS_PALADIN:
             return spellId == SPELL_SUMMON_CHARGER || spellId == SPELL_SUMMON_BLOOD_ELF_CHARGER;
@@ -328,12 +531,9 @@ bool IsBlockedEpicClassMountSpell(Player* bot, uint32 spellId)
     }
 }
 
-bool SpellTeachesBlockedEpicClassMountSpell(Player* bot, uint32 spellId)
+bool SpellTeachesBlockedEpicClassMountSpellForClass(uint8 classId, uint32 spellId)
 {
-    if (!bot || !spellId)
-        return false;
-
-    if (IsBlockedEpicClassMountSpell(bot, spellId))
+    if (IsBlockedEpicClassMountSpellForClass(classId, spellId))
         return true;
 
     SpellInfo const* spellInfo = sSpellMgr->GetSpellInfo(spellId);
@@ -342,27 +542,17 @@ bool SpellTeachesBlockedEpicClassMountSpell(Player* bot, uint32 spellId)
 
     for (SpellEffectInfo const& effect : spellInfo->GetEffects())
     {
-        if (!effect.IsEffect(SPELL_EFFECT_LEARN_SPELL) || !effect.TriggerSpell)
-            continue;
-
-        if (IsBlockedEpicClassMountSpell(bot, effect.TriggerSpell))
+        if (effect.IsEffect(SPELL_EFFECT_LEARN_SPELL) && effect.TriggerSpell &&
+            IsBlockedEpicClassMountSpellForClass(classId, effect.TriggerSpell))
             return true;
     }
 
     return false;
 }
 
-bool QuestRewardsBlockedEpicClassMountSpell(Player* bot, Quest const* quest)
+bool IsBlockedEpicClassMountSpell(Player* bot, uint32 spellId)
 {
-    if (!bot || !quest)
-        return false;
-
-    int32 const rewardCastSpell = quest->GetRewSpellCast();
-    if (rewardCastSpell > 0 && SpellTeachesBlockedEpicClassMountSpell(bot, static_cast<uint32>(rewardCastSpell)))
-        return true;
-
-    uint32 const rewardDisplaySpell = quest->GetRewSpell();
-    return rewardDisplaySpell && SpellTeachesBlockedEpicClassMountSpell(bot, rewardDisplaySpell);
+    return bot && IsBlockedEpicClassMountSpellForClass(bot->getClass(), spellId);
 }
 
 EpicClassMountSpellSnapshot CaptureEpicClassMountSpellState(Player* bot)
@@ -409,38 +599,35 @@ bool IsSecondaryProfessionSkillId(uint32 skillId)
     return std::find(secondaryProfessionSkillIds.begin(), secondaryProfessionSkillIds.end(), skillId) != secondaryProfessionSkillIds.end();
 }
 
-std::unordered_map<std::string, uint16> const& GetProfessionAliases()
-{
-    static std::unordered_map<std::string, uint16> aliases = {
-        { "alchemy", SKILL_ALCHEMY },
-        { "alch", SKILL_ALCHEMY },
-        { "blacksmithing", SKILL_BLACKSMITHING },
-        { "blacksmith", SKILL_BLACKSMITHING },
-        { "bs", SKILL_BLACKSMITHING },
-        { "enchanting", SKILL_ENCHANTING },
-        { "ench", SKILL_ENCHANTING },
-        { "engineering", SKILL_ENGINEERING },
-        { "eng", SKILL_ENGINEERING },
-        { "herbalism", SKILL_HERBALISM },
-        { "herb", SKILL_HERBALISM },
-        { "inscription", SKILL_INSCRIPTION },
-        { "insc", SKILL_INSCRIPTION },
-        { "jewelcrafting", SKILL_JEWELCRAFTING },
-        { "jewel", SKILL_JEWELCRAFTING },
-        { "jc", SKILL_JEWELCRAFTING },
-        { "leatherworking", SKILL_LEATHERWORKING },
-        { "lw", SKILL_LEATHERWORKING },
-        { "mining", SKILL_MINING },
-        { "mine", SKILL_MINING },
-        { "skinning", SKILL_SKINNING },
-        { "skin", SKILL_SKINNING },
-        { "tailoring", SKILL_TAILORING },
-        { "tailor", SKILL_TAILORING },
-        { "tail", SKILL_TAILORING }
-    };
-
-    return aliases;
-}
+constexpr std::array<TokenCatalogEntry<uint16>, 25> PROFESSION_ALIAS_CATALOG = { {
+    { 0, "alchemy", SKILL_ALCHEMY },
+    { 0, "alch", SKILL_ALCHEMY },
+    { 0, "blacksmithing", SKILL_BLACKSMITHING },
+    { 0, "blacksmith", SKILL_BLACKSMITHING },
+    { 0, "bs", SKILL_BLACKSMITHING },
+    { 0, "enchanting", SKILL_ENCHANTING },
+    { 0, "ench", SKILL_ENCHANTING },
+    { 0, "engineering", SKILL_ENGINEERING },
+    { 0, "eng", SKILL_ENGINEERING },
+    { 0, "herbalism", SKILL_HERBALISM },
+    { 0, "herb", SKILL_HERBALISM },
+    { 0, "inscription", SKILL_INSCRIPTION },
+    { 0, "insc", SKILL_INSCRIPTION },
+    { 0, "jewelcrafting", SKILL_JEWELCRAFTING },
+    { 0, "jewel", SKILL_JEWELCRAFTING },
+    { 0, "jc", SKILL_JEWELCRAFTING },
+    { 0, "leatherworking", SKILL_LEATHERWORKING },
+    { 0, "lw", SKILL_LEATHERWORKING },
+    { 0, "mining", SKILL_MINING },
+    { 0, "mine", SKILL_MINING },
+    { 0, "skinning", SKILL_SKINNING },
+    { 0, "skin", SKILL_SKINNING },
+    { 0, "tailoring", SKILL_TAILORING },
+    { 0, "tailor", SKILL_TAILORING },
+    { 0, "tail", SKILL_TAILORING },
+} };
+
+constexpr PerfectTokenTable<uint16, PROFESSION_ALIAS_CATALOG.size()> PROFESSION_ALIASES(PROFESSION_ALIAS_CATALOG);
 
 std::string ProfessionSkillToName(uint16 skillId)
 {
@@ -480,12 +667,11 @@ std::string BuildProfessionListMessage()
 
 bool ResolveProfessionSkill(std::string const& token, uint16& skillId)
 {
-    std::string const normalized = NormalizeToken(token);
-    auto const it = GetProfessionAliases().find(normalized);
-    if (it == GetProfessionAliases().end())
+    uint16 const* resolved = PROFESSION_ALIASES.Find(0, NormalizedToken(token));
+    if (!resolved)
         return false;
 
-    skillId = it->second;
+    skillId = *resolved;
     return true;
 }
 
@@ -613,7 +799,14 @@ struct ModuleConfig
     bool enabled = true;
     bool requireMasterControl = true;
     bool showSpecListOnEmpty = true;
+    bool quietSpellLearn = false;
     bool loginDiagnosticsEnable = true;
+    bool verifyCompiledSelectors = false;
+    uint32 slowCommandThresholdMs = 0;
+    bool verifyStaticEquip = false;
+
+    bool schedulerEnable = false;
+    uint32 schedulerTickBudgetMs = 10;
 
     bool autoGearRndBots = true;
     bool autoGearAltBots = false;
@@ -626,7 +819,8 @@ struct ModuleConfig
     std::string expansionSource = "auto";
     float gearValidationLowerRatio = 0.85f;
     float gearValidationUpperRatio = 1.15f;
-    uint8 gearRetryCount = 4;
+    uint32 gearScoreCacheEntries = 100000;
+    uint32 gearPlanCacheEntries = 256;
     uint8 gearQualityCapRatioMode = ITEM_QUALITY_EPIC;
     uint8 gearQualityCapTopForLevel = ITEM_QUALITY_LEGENDARY;
 
@@ -646,7 +840,6 @@ struct ModuleConfig
     bool specPlayerPostPetTalents = true;
     uint32 specPlayerTargetAverageIlvl60 = 62;
     uint32 specPlayerTargetAverageIlvl70 = 105;
-    uint8 specPlayerGearRetryCount = 6;
     uint8 specPlayerGearQualityCap = ITEM_QUALITY_EPIC;
     bool specPlayerExcludeQuestRewardItems = true;
     bool specPlayerEnforceUniqueRingTrinketPairs = true;
@@ -666,7 +859,14 @@ ModuleConfig LoadModuleConfig()
     config.enabled = sConfigMgr->GetOption<bool>(CONF_SPEC_ENABLE, true);
     config.requireMasterControl = sConfigMgr->GetOption<bool>(CONF_REQUIRE_MASTER_CONTROL, true);
     config.showSpecListOnEmpty = sConfigMgr->GetOption<bool>(CONF_SHOW_SPEC_LIST_ON_EMPTY, true);
+    config.quietSpellLearn = sConfigMgr->GetOption<bool>(CONF_QUIET_SPELL_LEARN, false);
     config.loginDiagnosticsEnable = sConfigMgr->GetOption<bool>(CONF_LOGIN_DIAGNOSTICS_ENABLE, true);
+    config.verifyCompiledSelectors = sConfigMgr->GetOption<bool>(CONF_SELECTORS_VERIFY_COMPILED, false);
+    config.slowCommandThresholdMs = sConfigMgr->GetOption<uint32>(CONF_SLOW_COMMAND_THRESHOLD_MS, 0);
+    config.verifyStaticEquip = sConfigMgr->GetOption<bool>(CONF_VERIFY_STATIC_EQUIP, false);
+
+    config.schedulerEnable = sConfigMgr->GetOption<bool>(CONF_SCHEDULER_ENABLE, false);
+    config.schedulerTickBudgetMs = sConfigMgr->GetOption<uint32>(CONF_SCHEDULER_TICK_BUDGET_MS, 10);
 
     config.autoGearRndBots = sConfigMgr->GetOption<bool>(CONF_AUTO_GEAR_RNDBOTS, true);
     config.autoGearAltBots = sConfigMgr->GetOption<bool>(CONF_AUTO_GEAR_ALTBOTS, false);
@@ -681,7 +881,8 @@ ModuleConfig LoadModuleConfig()
     config.expansionSource = NormalizeToken(sConfigMgr->GetOption<std::string>(CONF_EXPANSION_SOURCE, "auto"));
     config.gearValidationLowerRatio = sConfigMgr->GetOption<float>(CONF_GEAR_VALIDATION_LOWER_RATIO, 0.85f);
     config.gearValidationUpperRatio = sConfigMgr->GetOption<float>(CONF_GEAR_VALIDATION_UPPER_RATIO, 1.15f);
-    config.gearRetryCount = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_GEAR_RETRY_COUNT, 4));
+    config.gearScoreCacheEntries = sConfigMgr->GetOption<uint32>(CONF_GEAR_SCORE_CACHE_ENTRIES, 100000);
+    config.gearPlanCacheEntries = sConfigMgr->GetOption<uint32>(CONF_GEAR_PLAN_CACHE_ENTRIES, 256);
     config.gearQualityCapRatioMode = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_GEAR_QUALITY_CAP_RATIO_MODE, ITEM_QUALITY_EPIC));
     config.gearQualityCapTopForLevel = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_GEAR_QUALITY_CAP_TOP_FOR_LEVEL, ITEM_QUALITY_LEGENDARY));
     config.specPlayerMinSecurity = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_SPECPLAYER_MIN_SECURITY, SEC_GAMEMASTER));
@@ -703,7 +904,6 @@ ModuleConfig LoadModuleConfig()
         sConfigMgr->GetOption<uint32>(CONF_SPECPLAYER_TARGET_AVERAGE_ILVL_60, 62);
     config.specPlayerTargetAverageIlvl70 =
         sConfigMgr->GetOption<uint32>(CONF_SPECPLAYER_TARGET_AVERAGE_ILVL_70, 105);
-    config.specPlayerGearRetryCount = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_SPECPLAYER_GEAR_RETRY_COUNT, 6));
     config.specPlayerGearQualityCap = static_cast<uint8>(sConfigMgr->GetOption<uint32>(CONF_SPECPLAYER_GEAR_QUALITY_CAP, ITEM_QUALITY_EPIC));
     config.specPlayerExcludeQuestRewardItems = sConfigMgr->GetOption<bool>(CONF_SPECPLAYER_EXCLUDE_QUEST_REWARD_ITEMS, true);
     config.specPlayerEnforceUniqueRingTrinketPairs =
@@ -727,7 +927,6 @@ ModuleConfig LoadModuleConfig()
     if (config.gearValidationUpperRatio < config.gearValidationLowerRatio)
         config.gearValidationUpperRatio = config.gearValidationLowerRatio;
 
-    config.gearRetryCount = std::clamp<uint8>(config.gearRetryCount, 1, 20);
     config.gearQualityCapRatioMode = std::clamp<uint8>(config.gearQualityCapRatioMode, ITEM_QUALITY_NORMAL, ITEM_QUALITY_LEGENDARY);
     config.gearQualityCapTopForLevel = std::clamp<uint8>(config.gearQualityCapTopForLevel, ITEM_QUALITY_NORMAL, ITEM_QUALITY_LEGENDARY);
     config.specPlayerMinSecurity = std::clamp<uint8>(config.specPlayerMinSecurity, SEC_PLAYER, SEC_ADMINISTRATOR);
@@ -739,13 +938,258 @@ ModuleConfig LoadModuleConfig()
         std::clamp<uint16>(config.specPlayerRidingAdvancedSkill, config.specPlayerRidingBasicSkill, std::numeric_limits<uint16>::max());
     config.specPlayerTargetAverageIlvl60 = std::clamp<uint32>(config.specPlayerTargetAverageIlvl60, 1u, 1000u);
     config.specPlayerTargetAverageIlvl70 = std::clamp<uint32>(config.specPlayerTargetAverageIlvl70, 1u, 1000u);
-    config.specPlayerGearRetryCount = std::clamp<uint8>(config.specPlayerGearRetryCount, 1, 20);
     config.specPlayerGearQualityCap = std::clamp<uint8>(config.specPlayerGearQualityCap, ITEM_QUALITY_NORMAL, ITEM_QUALITY_LEGENDARY);
     config.specPlayerGearLevelSearchWindow = std::clamp<uint8>(config.specPlayerGearLevelSearchWindow, 0, 30);
 
     return config;
 }
 
+/* Published config snapshot.
+ * Chat hooks read this for every message, so the hot path is one shared
+ * pointer load; the option lookups above only run when worldserver config is
+ * (re)loaded, and only OnAfterConfigLoad publishes. Readers keep their own
+ * reference, so a snapshot lives exactly as long as someone still uses it.
+ * Before the first publish, a reader gets a private, unpublished load.
+ */
+
+std::shared_ptr<ModuleConfig const> publishedModuleConfig;
+
+void PublishModuleConfig()
+{
+    std::atomic_store_explicit(&publishedModuleConfig, std::make_shared<ModuleConfig const>(LoadModuleConfig()),
+                               std::memory_order_release);
+}
+
+std::shared_ptr<ModuleConfig const> GetModuleConfig()
+{
+    std::shared_ptr<ModuleConfig const> config = std::atomic_load_explicit(&publishedModuleConfig, std::memory_order_acquire);
+    if (!config)
+        config = std::make_shared<ModuleConfig const>(LoadModuleConfig());
+
+    return config;
+}
+
+/* Per-stage command instrumentation.
+ * Every heavy command opens a ScopedCommandTrace; the stages inside it are
+ * wrapped in ScopedStageTimer blocks that add to the open trace. When the
+ * trace closes, each stage it touched contributes one sample to a rolling
+ * window per command and stage, which `.bettersetup stats` turns into
+ * percentiles. A trace slower than SlowCommandThresholdMs also writes one log
+ * line with its full stage breakdown. Stage timers outside any trace cost a
+ * clock read and nothing else.
+ */
+
+enum class CommandStage : uint8
+{
+    Total,
+    Maintenance,
+    Talents,
+    Spells,
+    Skills,
+    Gear,
+    Glyphs,
+    Enchants,
+    Pet,
+    Mounts,
+    Reputation,
+    AIReset,
+    Count
+};
+
+constexpr size_t COMMAND_STAGE_COUNT = static_cast<size_t>(CommandStage::Count);
+constexpr size_t STAGE_SAMPLE_WINDOW = 1024;
+
+char const* CommandStageToString(CommandStage stage)
+{
+    switch (stage)
+    {
+        case CommandStage::Total:
+            return "total";
+        case CommandStage::Maintenance:
+            return "maintenance";
+        case CommandStage::Talents:
+            return "talents";
+        case CommandStage::Spells:
+            return "spells";
+        case CommandStage::Skills:
+            return "skills";
+        case CommandStage::Gear:
+            return "gear";
+        case CommandStage::Glyphs:
+            return "glyphs";
+        case CommandStage::Enchants:
+            return "enchants";
+        case CommandStage::Pet:
+            return "pet";
+        case CommandStage::Mounts:
+            return "mounts";
+        case CommandStage::Reputation:
+            return "reputation";
+        case CommandStage::AIReset:
+            return "aireset";
+        case CommandStage::Count:
+        default:
+            return "unknown";
+    }
+}
+
+struct StageStats
+{
+    uint64 count = 0;
+    uint32 maxUs = 0;
+    std::vector<uint32> samplesUs;
+    size_t nextSample = 0;
+};
+
+using CommandStageStats = std::array<StageStats, COMMAND_STAGE_COUNT>;
+
+std::map<std::string, CommandStageStats>& GetCommandStageStats()
+{
+    static std::map<std::string, CommandStageStats> stats;
+    return stats;
+}
+
+void RecordStageSample(char const* command, CommandStage stage, std::chrono::steady_clock::duration elapsed)
+{
+    uint64 const elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    uint32 const sampleUs = static_cast<uint32>(std::min<uint64>(elapsedUs, std::numeric_limits<uint32>::max()));
+
+    StageStats& stats = GetCommandStageStats()[command][static_cast<size_t>(stage)];
+    stats.count++;
+    stats.maxUs = std::max(stats.maxUs, sampleUs);
+
+    /* Fixed-size window: keep the latest samples once the buffer is full. */
+
+    if (stats.samplesUs.size() < STAGE_SAMPLE_WINDOW)
+    {
+        stats.samplesUs.push_back(sampleUs);
+        return;
+    }
+
+    stats.samplesUs[stats.nextSample] = sampleUs;
+    stats.nextSample = (stats.nextSample + 1) % STAGE_SAMPLE_WINDOW;
+}
+
+struct CommandTrace
+{
+    char const* command = nullptr;
+    Player* bot = nullptr;
+    uint32 fanout = 1;
+    uint32 gearAttempts = 0;
+    std::array<std::chrono::steady_clock::duration, COMMAND_STAGE_COUNT> stageTime = {};
+    std::array<bool, COMMAND_STAGE_COUNT> stageSeen = {};
+};
+
+CommandTrace* currentCommandTrace = nullptr;
+
+/* Set by the job runner so traces know how wide the order was; direct callers count as one. */
+
+uint32 currentCommandFanout = 1;
+
+void NoteGearAttempt()
+{
+    if (currentCommandTrace)
+        currentCommandTrace->gearAttempts++;
+}
+
+double StageMilliseconds(std::chrono::steady_clock::duration elapsed)
+{
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+void LogSlowCommand(CommandTrace const& trace)
+{
+    std::ostringstream stages;
+    stages.setf(std::ios::fixed);
+    stages.precision(1);
+
+    for (size_t stage = 0; stage < COMMAND_STAGE_COUNT; ++stage)
+    {
+        if (stage == static_cast<size_t>(CommandStage::Total) || !trace.stageSeen[stage])
+            continue;
+
+        stages << ' ' << CommandStageToString(static_cast<CommandStage>(stage)) << '=' << StageMilliseconds(trace.stageTime[stage]);
+    }
+
+    Player* bot = trace.bot;
+    LOG_WARN("module",
+             "mod-playerbot-bettersetup: slow command={} bot={} guid={} class={} level={} fanout={} total_ms={:.1f} gear_attempts={} stages_ms:{}",
+             trace.command, bot ? bot->GetName() : "<none>", bot ? bot->GetGUID().GetCounter() : 0, bot ? uint32(bot->getClass()) : 0,
+             bot ? uint32(bot->GetLevel()) : 0, trace.fanout, StageMilliseconds(trace.stageTime[static_cast<size_t>(CommandStage::Total)]),
+             trace.gearAttempts, stages.str());
+}
+
+class ScopedCommandTrace
+{
+public:
+    ScopedCommandTrace(char const* command, Player* bot)
+        : previous(currentCommandTrace), start(std::chrono::steady_clock::now())
+    {
+        trace.command = command;
+        trace.bot = bot;
+        trace.fanout = currentCommandFanout;
+        currentCommandTrace = &trace;
+    }
+
+    ~ScopedCommandTrace()
+    {
+        trace.stageTime[static_cast<size_t>(CommandStage::Total)] = std::chrono::steady_clock::now() - start;
+        trace.stageSeen[static_cast<size_t>(CommandStage::Total)] = true;
+
+        for (size_t stage = 0; stage < COMMAND_STAGE_COUNT; ++stage)
+        {
+            if (trace.stageSeen[stage])
+                RecordStageSample(trace.command, static_cast<CommandStage>(stage), trace.stageTime[stage]);
+        }
+
+        uint32 const thresholdMs = GetModuleConfig()->slowCommandThresholdMs;
+        if (thresholdMs && trace.stageTime[static_cast<size_t>(CommandStage::Total)] >= std::chrono::milliseconds(thresholdMs))
+            LogSlowCommand(trace);
+
+        currentCommandTrace = previous;
+    }
+
+    ScopedCommandTrace(ScopedCommandTrace const&) = delete;
+    ScopedCommandTrace& operator=(ScopedCommandTrace const&) = delete;
+
+private:
+    CommandTrace trace;
+    CommandTrace* previous;
+    std::chrono::steady_clock::time_point start;
+};
+
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(CommandStage stage)
+        : stage(stage), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (!currentCommandTrace)
+            return;
+
+        currentCommandTrace->stageTime[static_cast<size_t>(stage)] += std::chrono::steady_clock::now() - start;
+        currentCommandTrace->stageSeen[static_cast<size_t>(stage)] = true;
+    }
+
+    ScopedStageTimer(ScopedStageTimer const&) = delete;
+    ScopedStageTimer& operator=(ScopedStageTimer const&) = delete;
+
+private:
+    CommandStage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+uint32 StageSamplePercentile(std::vector<uint32>& samples, uint32 percentile)
+{
+    size_t const index = std::min(samples.size() - 1, samples.size() * percentile / 100);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
 void NormalizeSpecPlayerRidingForLevel(Player* target, ModuleConfig const& config)
 {
     if (!target || !config.specPlayerNormalizeRiding)
@@ -771,7 +1215,6 @@ void NormalizeSpecPlayerRidingForLevel(Player* target, ModuleConfig const& confi
 struct SpecDefinition
 {
     std::string canonical;
-    std::vector<std::string> aliases;
     std::vector<std::string> matchTokens;
     std::vector<uint8> preferredSpecIndexes;
 };
@@ -779,13 +1222,14 @@ struct SpecDefinition
 struct ClassSpecProfile
 {
     std::vector<SpecDefinition> specs;
-    std::map<std::string, std::vector<std::string>> roles;
+    std::map<std::string, std::vector<std::string>, std::less<>> roles;
 };
 
 using ClassSpecMap = std::map<uint8, ClassSpecProfile>;
 
 /* Canonical class->spec dictionary.
- * Aliases are what humans type at 2am; canonical names are what logic can trust.
+ * Canonical names are what logic can trust; the aliases humans type at 2am
+ * live in SPEC_ALIAS_CATALOG below.
  * preferredSpecIndexes are first choice; token matching is the backup detective.
  */
 
@@ -796,9 +1240,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_WARRIOR,
             {
                 {
-                    { "arms", { "arms", "arm" }, { "arms" }, { 0 } },
-                    { "fury", { "fury", "fur" }, { "fury" }, { 1 } },
-                    { "protection", { "protection", "prot" }, { "prot", "protection" }, { 2 } },
+                    { "arms", { "arms" }, { 0 } },
+                    { "fury", { "fury" }, { 1 } },
+                    { "protection", { "prot", "protection" }, { 2 } },
                 },
                 {
                     { "tank", { "protection" } },
@@ -811,9 +1255,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_PALADIN,
             {
                 {
-                    { "holy", { "holy", "hpal" }, { "holy" }, { 0 } },
-                    { "protection", { "protection", "prot" }, { "prot", "protection" }, { 1 } },
-                    { "retribution", { "retribution", "ret" }, { "ret", "retribution" }, { 2 } },
+                    { "holy", { "holy" }, { 0 } },
+                    { "protection", { "prot", "protection" }, { 1 } },
+                    { "retribution", { "ret", "retribution" }, { 2 } },
                 },
                 {
                     { "tank", { "protection" } },
@@ -827,9 +1271,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_HUNTER,
             {
                 {
-                    { "beastmaster", { "beastmaster", "beastmastery", "beast mastery", "bm" }, { "bm", "beast" }, { 0 } },
-                    { "marksman", { "marksman", "mm" }, { "mm", "marksman", "marksmanship" }, { 1 } },
-                    { "survival", { "survival", "surv", "sv" }, { "surv", "survival" }, { 2 } },
+                    { "beastmaster", { "bm", "beast" }, { 0 } },
+                    { "marksman", { "mm", "marksman", "marksmanship" }, { 1 } },
+                    { "survival", { "surv", "survival" }, { 2 } },
                 },
                 {
                     { "ranged", { "beastmaster", "marksman", "survival" } },
@@ -841,9 +1285,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_ROGUE,
             {
                 {
-                    { "assassination", { "assassination", "as" }, { "as", "assassination" }, { 0 } },
-                    { "combat", { "combat", "comb" }, { "combat" }, { 1 } },
-                    { "subtlety", { "subtlety", "sub" }, { "subtlety", "sub" }, { 2 } },
+                    { "assassination", { "as", "assassination" }, { 0 } },
+                    { "combat", { "combat" }, { 1 } },
+                    { "subtlety", { "subtlety", "sub" }, { 2 } },
                 },
                 {
                     { "melee", { "assassination", "combat", "subtlety" } },
@@ -855,9 +1299,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_PRIEST,
             {
                 {
-                    { "discipline", { "discipline", "disc" }, { "disc", "discipline" }, { 0 } },
-                    { "holy", { "holy", "hpr" }, { "holy" }, { 1 } },
-                    { "shadow", { "shadow", "spr" }, { "shadow" }, { 2 } },
+                    { "discipline", { "disc", "discipline" }, { 0 } },
+                    { "holy", { "holy" }, { 1 } },
+                    { "shadow", { "shadow" }, { 2 } },
                 },
                 {
                     { "heal", { "discipline", "holy" } },
@@ -870,10 +1314,10 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_DEATH_KNIGHT,
             {
                 {
-                    { "blood_tank", { "blood_tank", "blood tank", "bloodtank", "bdkt" }, { "blood" }, { 0 } },
-                    { "blood_dps", { "blood_dps", "blood dps", "blooddps", "bdkd" }, { "double aura blood", "blood dps", "blood" }, { 3, 0 } },
-                    { "frost", { "frost", "fr" }, { "frost" }, { 1 } },
-                    { "unholy", { "unholy", "uh" }, { "unholy" }, { 2 } },
+                    { "blood_tank", { "blood" }, { 0 } },
+                    { "blood_dps", { "double aura blood", "blood dps", "blood" }, { 3, 0 } },
+                    { "frost", { "frost" }, { 1 } },
+                    { "unholy", { "unholy" }, { 2 } },
                 },
                 {
                     { "tank", { "blood_tank" } },
@@ -886,9 +1330,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_SHAMAN,
             {
                 {
-                    { "elemental", { "elemental", "ele" }, { "ele", "elemental" }, { 0 } },
-                    { "enhancement", { "enhancement", "enh" }, { "enh", "enhancement" }, { 1 } },
-                    { "restoration", { "restoration", "resto" }, { "resto", "restoration" }, { 2 } },
+                    { "elemental", { "ele", "elemental" }, { 0 } },
+                    { "enhancement", { "enh", "enhancement" }, { 1 } },
+                    { "restoration", { "resto", "restoration" }, { 2 } },
                 },
                 {
                     { "heal", { "restoration" } },
@@ -902,9 +1346,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_MAGE,
             {
                 {
-                    { "arcane", { "arcane", "arc" }, { "arcane" }, { 0 } },
-                    { "fire", { "fire", "fir" }, { "fire" }, { 1 } },
-                    { "frost", { "frost", "fr" }, { "frost" }, { 2 } },
+                    { "arcane", { "arcane" }, { 0 } },
+                    { "fire", { "fire" }, { 1 } },
+                    { "frost", { "frost" }, { 2 } },
                 },
                 {
                     { "ranged", { "arcane", "fire", "frost" } },
@@ -916,9 +1360,9 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_WARLOCK,
             {
                 {
-                    { "affliction", { "affliction", "affli", "aff" }, { "affli", "affliction" }, { 0 } },
-                    { "demonology", { "demonology", "demo" }, { "demo", "demonology" }, { 1 } },
-                    { "destruction", { "destruction", "destro", "dest" }, { "destro", "destruction" }, { 2 } },
+                    { "affliction", { "affli", "affliction" }, { 0 } },
+                    { "demonology", { "demo", "demonology" }, { 1 } },
+                    { "destruction", { "destro", "destruction" }, { 2 } },
                 },
                 {
                     { "ranged", { "affliction", "demonology", "destruction" } },
@@ -930,10 +1374,10 @@ ClassSpecMap const& GetClassSpecProfiles()
             CLASS_DRUID,
             {
                 {
-                    { "balance", { "balance", "bal" }, { "balance" }, { 0 } },
-                    { "feral_tank", { "feral_tank", "feral tank", "feraltank", "bear" }, { "bear" }, { 1 } },
-                    { "feral_dps", { "feral_dps", "feral dps", "feraldps", "cat" }, { "cat" }, { 3 } },
-                    { "restoration", { "restoration", "resto" }, { "resto", "restoration" }, { 2 } },
+                    { "balance", { "balance" }, { 0 } },
+                    { "feral_tank", { "bear" }, { 1 } },
+                    { "feral_dps", { "cat" }, { 3 } },
+                    { "restoration", { "resto", "restoration" }, { 2 } },
                 },
                 {
                     { "tank", { "feral_tank" } },
@@ -949,7 +1393,93 @@ ClassSpecMap const& GetClassSpecProfiles()
     return profiles;
 }
 
-SpecDefinition const* FindSpecDefinition(ClassSpecProfile const& profile, std::string const& canonical)
+/* Exact spec aliases per class, already normalized (lowercase, alphanumeric),
+ * so "blood tank", "blood_tank" and "bloodtank" are one entry.
+ */
+
+constexpr std::array<TokenCatalogEntry<std::string_view>, 68> SPEC_ALIAS_CATALOG = { {
+    { CLASS_WARRIOR, "arms", "arms" },
+    { CLASS_WARRIOR, "arm", "arms" },
+    { CLASS_WARRIOR, "fury", "fury" },
+    { CLASS_WARRIOR, "fur", "fury" },
+    { CLASS_WARRIOR, "protection", "protection" },
+    { CLASS_WARRIOR, "prot", "protection" },
+
+    { CLASS_PALADIN, "holy", "holy" },
+    { CLASS_PALADIN, "hpal", "holy" },
+    { CLASS_PALADIN, "protection", "protection" },
+    { CLASS_PALADIN, "prot", "protection" },
+    { CLASS_PALADIN, "retribution", "retribution" },
+    { CLASS_PALADIN, "ret", "retribution" },
+
+    { CLASS_HUNTER, "beastmaster", "beastmaster" },
+    { CLASS_HUNTER, "beastmastery", "beastmaster" },
+    { CLASS_HUNTER, "bm", "beastmaster" },
+    { CLASS_HUNTER, "marksman", "marksman" },
+    { CLASS_HUNTER, "mm", "marksman" },
+    { CLASS_HUNTER, "survival", "survival" },
+    { CLASS_HUNTER, "surv", "survival" },
+    { CLASS_HUNTER, "sv", "survival" },
+
+    { CLASS_ROGUE, "assassination", "assassination" },
+    { CLASS_ROGUE, "as", "assassination" },
+    { CLASS_ROGUE, "combat", "combat" },
+    { CLASS_ROGUE, "comb", "combat" },
+    { CLASS_ROGUE, "subtlety", "subtlety" },
+    { CLASS_ROGUE, "sub", "subtlety" },
+
+    { CLASS_PRIEST, "discipline", "discipline" },
+    { CLASS_PRIEST, "disc", "discipline" },
+    { CLASS_PRIEST, "holy", "holy" },
+    { CLASS_PRIEST, "hpr", "holy" },
+    { CLASS_PRIEST, "shadow", "shadow" },
+    { CLASS_PRIEST, "spr", "shadow" },
+
+    { CLASS_DEATH_KNIGHT, "bloodtank", "blood_tank" },
+    { CLASS_DEATH_KNIGHT, "bdkt", "blood_tank" },
+    { CLASS_DEATH_KNIGHT, "blooddps", "blood_dps" },
+    { CLASS_DEATH_KNIGHT, "bdkd", "blood_dps" },
+    { CLASS_DEATH_KNIGHT, "frost", "frost" },
+    { CLASS_DEATH_KNIGHT, "fr", "frost" },
+    { CLASS_DEATH_KNIGHT, "unholy", "unholy" },
+    { CLASS_DEATH_KNIGHT, "uh", "unholy" },
+
+    { CLASS_SHAMAN, "elemental", "elemental" },
+    { CLASS_SHAMAN, "ele", "elemental" },
+    { CLASS_SHAMAN, "enhancement", "enhancement" },
+    { CLASS_SHAMAN, "enh", "enhancement" },
+    { CLASS_SHAMAN, "restoration", "restoration" },
+    { CLASS_SHAMAN, "resto", "restoration" },
+
+    { CLASS_MAGE, "arcane", "arcane" },
+    { CLASS_MAGE, "arc", "arcane" },
+    { CLASS_MAGE, "fire", "fire" },
+    { CLASS_MAGE, "fir", "fire" },
+    { CLASS_MAGE, "frost", "frost" },
+    { CLASS_MAGE, "fr", "frost" },
+
+    { CLASS_WARLOCK, "affliction", "affliction" },
+    { CLASS_WARLOCK, "affli", "affliction" },
+    { CLASS_WARLOCK, "aff", "affliction" },
+    { CLASS_WARLOCK, "demonology", "demonology" },
+    { CLASS_WARLOCK, "demo", "demonology" },
+    { CLASS_WARLOCK, "destruction", "destruction" },
+    { CLASS_WARLOCK, "destro", "destruction" },
+    { CLASS_WARLOCK, "dest", "destruction" },
+
+    { CLASS_DRUID, "balance", "balance" },
+    { CLASS_DRUID, "bal", "balance" },
+    { CLASS_DRUID, "feraltank", "feral_tank" },
+    { CLASS_DRUID, "bear", "feral_tank" },
+    { CLASS_DRUID, "feraldps", "feral_dps" },
+    { CLASS_DRUID, "cat", "feral_dps" },
+    { CLASS_DRUID, "restoration", "restoration" },
+    { CLASS_DRUID, "resto", "restoration" },
+} };
+
+constexpr PerfectTokenTable<std::string_view, SPEC_ALIAS_CATALOG.size()> SPEC_ALIASES(SPEC_ALIAS_CATALOG);
+
+SpecDefinition const* FindSpecDefinition(ClassSpecProfile const& profile, std::string_view canonical)
 {
     auto const it = std::find_if(profile.specs.begin(), profile.specs.end(), [&](SpecDefinition const& spec)
     {
@@ -1013,7 +1543,7 @@ bool MatchPremadeNameByToken(std::string const& premadeNameLower, std::vector<st
  * In other words: strict when possible, practical when the world is on fire.
  */
 
-int FindSpecNoForDefinition(uint8 classId, SpecDefinition const& spec)
+int ComputeSpecNoForDefinition(uint8 classId, SpecDefinition const& spec)
 {
     auto const hasPremade = [&](uint8 specNo)
     {
@@ -1074,6 +1604,85 @@ int FindSpecNoForDefinition(uint8 classId, SpecDefinition const& spec)
     return -1;
 }
 
+/* Canonical spec <-> premade specNo, resolved once per class.
+ * The premade names only change when playerbots reloads its config, so the
+ * token matching above runs once per (class, spec definition) and every
+ * later lookup is an array index. Cleared on config reload, rebuilt on use.
+ */
+
+struct SpecNoTable
+{
+    std::vector<int> specNoByDefinition;
+    std::array<int, MAX_SPECNO> definitionBySpecNo = {};
+};
+
+std::vector<SpecNoTable>& GetSpecNoTables()
+{
+    static std::vector<SpecNoTable> tables;
+    return tables;
+}
+
+void ClearSpecNoTables()
+{
+    GetSpecNoTables().clear();
+}
+
+SpecNoTable const* GetSpecNoTable(uint8 classId)
+{
+    if (classId >= MAX_CLASSES)
+        return nullptr;
+
+    std::vector<SpecNoTable>& tables = GetSpecNoTables();
+    if (tables.empty())
+    {
+        tables.resize(MAX_CLASSES);
+        for (SpecNoTable& table : tables)
+            table.definitionBySpecNo.fill(-1);
+
+        for (auto const& [profileClass, profile] : GetClassSpecProfiles())
+        {
+            if (profileClass >= MAX_CLASSES)
+                continue;
+
+            SpecNoTable& table = tables[profileClass];
+            table.specNoByDefinition.reserve(profile.specs.size());
+
+            for (size_t index = 0; index < profile.specs.size(); ++index)
+            {
+                int const specNo = ComputeSpecNoForDefinition(profileClass, profile.specs[index]);
+                table.specNoByDefinition.push_back(specNo);
+
+                if (specNo >= 0 && specNo < static_cast<int>(MAX_SPECNO) && table.definitionBySpecNo[specNo] < 0)
+                    table.definitionBySpecNo[specNo] = static_cast<int>(index);
+            }
+        }
+    }
+
+    return &tables[classId];
+}
+
+int FindSpecNoForDefinition(uint8 classId, SpecDefinition const& spec)
+{
+    ClassSpecMap const& profiles = GetClassSpecProfiles();
+    auto const profileIt = profiles.find(classId);
+    SpecNoTable const* table = GetSpecNoTable(classId);
+    if (profileIt == profiles.end() || !table)
+        return ComputeSpecNoForDefinition(classId, spec);
+
+    /* Definitions handed around the module all live in the profile table;
+     * a class has at most four, so finding ours by identity is a short walk.
+     */
+
+    std::vector<SpecDefinition> const& specs = profileIt->second.specs;
+    for (size_t index = 0; index < specs.size(); ++index)
+    {
+        if (&specs[index] == &spec)
+            return table->specNoByDefinition[index];
+    }
+
+    return ComputeSpecNoForDefinition(classId, spec);
+}
+
 std::string FormatCanonicalName(std::string const& canonical)
 {
     std::string name = canonical;
@@ -1152,36 +1761,21 @@ char const* PetSpecChoiceToString(PetSpecChoice choice)
     }
 }
 
-bool ParsePetSpecChoice(std::string const& token, PetSpecChoice& choice)
-{
-    std::string const normalized = NormalizeToken(token);
-    if (normalized == "tank")
-    {
-        choice = PetSpecChoice::Tank;
-        return true;
-    }
+constexpr std::array<TokenCatalogEntry<PetSpecChoice>, 4> PET_SPEC_CATALOG = { {
+    { 0, "tank", PetSpecChoice::Tank },
+    { 0, "dps", PetSpecChoice::Dps },
+    { 0, "stealth", PetSpecChoice::Stealth },
+    { 0, "control", PetSpecChoice::Control },
+} };
 
-    if (normalized == "dps")
-    {
-        choice = PetSpecChoice::Dps;
-        return true;
-    }
+constexpr PerfectTokenTable<PetSpecChoice, PET_SPEC_CATALOG.size()> PET_SPEC_CHOICES(PET_SPEC_CATALOG);
 
-    if (normalized == "stealth")
-    {
-        choice = PetSpecChoice::Stealth;
-        return true;
-    }
-
-    if (normalized == "control")
-    {
-        choice = PetSpecChoice::Control;
-        return true;
-    }
-
-    choice = PetSpecChoice::None;
-    return false;
-}
+bool ParsePetSpecChoice(std::string_view token, PetSpecChoice& choice)
+{
+    PetSpecChoice const* resolved = PET_SPEC_CHOICES.Find(0, NormalizedToken(token));
+    choice = resolved ? *resolved : PetSpecChoice::None;
+    return resolved != nullptr;
+}
 
 bool SupportsPetSpecCommand(Player* bot)
 {
@@ -1215,21 +1809,26 @@ enum class SpecControlAction
     SwitchSecondary
 };
 
+/* The parsed form never owns text: specProfile views the command it was
+ * parsed from, and errorMessage only ever points at a string literal.
+ * Keep the source buffer alive for as long as the parse is in use.
+ */
+
 struct ParsedBotCommand
 {
     BotCommandType type = BotCommandType::None;
     bool listOnly = false;
     PetSpecChoice petSpecChoice = PetSpecChoice::None;
     SpecControlAction specControlAction = SpecControlAction::None;
-    std::string specProfile;
-    std::string errorMessage;
+    std::string_view specProfile;
+    std::string_view errorMessage;
 };
 
-ParsedBotCommand ParseBotCommand(std::string const& command)
+ParsedBotCommand ParseBotCommand(std::string_view command)
 {
     ParsedBotCommand parsed;
 
-    std::vector<std::string> words = SplitWords(command);
+    std::vector<std::string_view> words = SplitWordViews(command);
     if (words.empty())
         return parsed;
 
@@ -1325,16 +1924,367 @@ ParsedBotCommand ParseBotCommand(std::string const& command)
         return parsed;
     }
 
-    parsed.specProfile = JoinWords(words, 1);
+    parsed.specProfile = std::string_view(words[1].data(), words.back().data() + words.back().size() - words[1].data());
     return parsed;
 }
 
+/* Raw-message verb recognizer.
+ * Chat hooks call this before collecting any targets, so ordinary chatter
+ * never pays for a group, guild, or random-bot scan. It walks the message once
+ * with no allocations, honours commandSeparator and commandPrefix the same way
+ * ProcessModuleCommandsForBot does, and skips leading @selector words.
+ * It only has to be permissive: whatever it rejects could never reach a
+ * module verb in ParseBotCommand.
+ */
+
+constexpr std::array<std::string_view, 4> MODULE_COMMAND_VERBS = { "setup", "spec", "restock", "petspec" };
+
+bool WordNormalizesTo(std::string_view word, std::string_view expected)
+{
+    size_t matched = 0;
+
+    for (unsigned char c : word)
+    {
+        if (!std::isalnum(c))
+            continue;
+
+        if (matched == expected.size() || static_cast<char>(std::tolower(c)) != expected[matched])
+            return false;
+
+        ++matched;
+    }
+
+    return matched == expected.size();
+}
+
+bool IsModuleCommandVerbWord(std::string_view word)
+{
+    for (std::string_view verb : MODULE_COMMAND_VERBS)
+    {
+        if (WordNormalizesTo(word, verb))
+            return true;
+    }
+
+    return false;
+}
+
+bool SubCommandMayContainModuleVerb(std::string_view command, std::string_view prefix)
+{
+    auto const isSpace = [](unsigned char c) { return std::isspace(c) != 0; };
+
+    size_t pos = 0;
+    while (pos < command.size() && isSpace(command[pos]))
+        ++pos;
+
+    if (!prefix.empty())
+    {
+        if (command.substr(pos, prefix.size()) != prefix)
+            return false;
+
+        pos += prefix.size();
+    }
+
+    while (pos < command.size())
+    {
+        while (pos < command.size() && isSpace(command[pos]))
+            ++pos;
+
+        if (pos == command.size())
+            break;
+
+        size_t end = pos;
+        while (end < command.size() && !isSpace(command[end]))
+            ++end;
+
+        std::string_view const word = command.substr(pos, end - pos);
+        if (IsModuleCommandVerbWord(word))
+            return true;
+
+        /* Only selector words may sit in front of the verb. */
+
+        if (word.front() != '@')
+            return false;
+
+        pos = end;
+    }
+
+    return false;
+}
+
+bool MessageMayContainModuleCommand(std::string_view message)
+{
+    std::string_view const separator = sPlayerbotAIConfig.commandSeparator;
+    std::string_view const prefix = sPlayerbotAIConfig.commandPrefix;
+
+    if (separator.empty())
+        return SubCommandMayContainModuleVerb(message, prefix);
+
+    size_t begin = 0;
+    while (begin <= message.size())
+    {
+        size_t const pos = message.find(separator, begin);
+        if (pos == std::string_view::npos)
+            return SubCommandMayContainModuleVerb(message.substr(begin), prefix);
+
+        if (SubCommandMayContainModuleVerb(message.substr(begin, pos - begin), prefix))
+            return true;
+
+        begin = pos + separator.size();
+    }
+
+    return false;
+}
+
+/* Parse-once command plan.
+ * A chat message is split, prefix-stripped, and parsed a single time before
+ * fan-out; every target bot then only runs its selector filter and the
+ * command itself. text keeps the leading @selector words, commandText starts
+ * at the verb and is what parsed was built from. Everything views the
+ * original message, so the plan must not outlive it.
+ */
+
+/* Compiled @selector predicates.
+ * The everyday selectors are lowered once per message into plain constraints
+ * that mirror the mod-playerbots chat filters: class, role, raid subgroup, and
+ * exact level. A matching selector is peeled off, a mismatching one drops the
+ * command for that bot, and several selectors must all hold. Anything else
+ * (ranges, raid marks, combat types, whatever upstream invents next) leaves
+ * the command uncompiled, and it keeps going through CompositeChatFilter.
+ */
+
+constexpr size_t MAX_COMPILED_SELECTORS = 4;
+
+constexpr std::array<std::pair<std::string_view, uint8>, 9> SELECTOR_CLASS_TOKENS = { {
+    { "@warrior", CLASS_WARRIOR },
+    { "@paladin", CLASS_PALADIN },
+    { "@hunter", CLASS_HUNTER },
+    { "@rogue", CLASS_ROGUE },
+    { "@priest", CLASS_PRIEST },
+    { "@shaman", CLASS_SHAMAN },
+    { "@mage", CLASS_MAGE },
+    { "@warlock", CLASS_WARLOCK },
+    { "@druid", CLASS_DRUID }
+} };
+
+struct BotSelectorDescriptor
+{
+    uint8 classId = 0;
+    uint8 level = 0;
+    uint8 subGroup = 0;
+    bool tank = false;
+    bool heal = false;
+};
+
+struct CompiledSelector
+{
+    bool compiled = false;
+    bool impossible = false;
+    uint8 classId = 0;
+    uint8 subGroup = 0;
+    uint32 level = 0;
+    bool requireTank = false;
+    bool requireHeal = false;
+    bool requireDps = false;
+};
+
+bool ParseSelectorNumber(std::string_view digits, size_t maxDigits, uint32& value)
+{
+    if (digits.empty() || digits.size() > maxDigits)
+        return false;
+
+    value = 0;
+    for (char c : digits)
+    {
+        if (c < '0' || c > '9')
+            return false;
+
+        value = value * 10 + static_cast<uint32>(c - '0');
+    }
+
+    return true;
+}
+
+template <typename T>
+void RequireSelectorValue(T& slot, T value, bool& impossible)
+{
+    if (slot && slot != value)
+        impossible = true;
+
+    slot = value;
+}
+
+bool CompileSelectorToken(std::string_view token, CompiledSelector& selector)
+{
+    for (auto const& [name, classId] : SELECTOR_CLASS_TOKENS)
+    {
+        if (token != name)
+            continue;
+
+        RequireSelectorValue<uint8>(selector.classId, classId, selector.impossible);
+        return true;
+    }
+
+    if (token == "@tank")
+    {
+        selector.requireTank = true;
+        return true;
+    }
+
+    if (token == "@heal")
+    {
+        selector.requireHeal = true;
+        return true;
+    }
+
+    if (token == "@dps")
+    {
+        selector.requireDps = true;
+        return true;
+    }
+
+    uint32 value = 0;
+    if (token.substr(0, 6) == "@group")
+    {
+        if (!ParseSelectorNumber(token.substr(6), 2, value))
+            return false;
+
+        /* Subgroups are 1-based in chat; @group0 simply never matches. */
+
+        if (!value || value > MAX_RAID_SUBGROUPS)
+            selector.impossible = true;
+        else
+            RequireSelectorValue<uint8>(selector.subGroup, static_cast<uint8>(value), selector.impossible);
+
+        return true;
+    }
+
+    if (!ParseSelectorNumber(token.substr(1), 3, value))
+        return false;
+
+    if (!value)
+        selector.impossible = true;
+    else
+        RequireSelectorValue<uint32>(selector.level, value, selector.impossible);
+
+    return true;
+}
+
+CompiledSelector CompileSelectors(std::string_view text, std::string_view commandText)
+{
+    /* The upstream level filter reads any dash in the remaining line as a range. */
+
+    if (text.find('-') != std::string_view::npos)
+        return {};
+
+    std::vector<std::string_view> const tokens = SplitWordViews(text.substr(0, text.size() - commandText.size()));
+    if (tokens.size() > MAX_COMPILED_SELECTORS)
+        return {};
+
+    CompiledSelector selector;
+    for (std::string_view token : tokens)
+    {
+        if (!CompileSelectorToken(token, selector))
+            return {};
+    }
+
+    selector.compiled = true;
+    return selector;
+}
+
+bool MatchesCompiledSelector(CompiledSelector const& selector, BotSelectorDescriptor const& bot)
+{
+    if (selector.impossible)
+        return false;
+
+    if (selector.classId && selector.classId != bot.classId)
+        return false;
+
+    if (selector.subGroup && selector.subGroup != bot.subGroup)
+        return false;
+
+    if (selector.level && selector.level != bot.level)
+        return false;
+
+    if (selector.requireTank && !bot.tank)
+        return false;
+
+    if (selector.requireHeal && !bot.heal)
+        return false;
+
+    return !selector.requireDps || (!bot.tank && !bot.heal);
+}
+
+struct PlannedCommand
+{
+    std::string_view text;
+    std::string_view commandText;
+    ParsedBotCommand parsed;
+    CompiledSelector selector;
+};
+
+struct CommandPlan
+{
+    std::vector<PlannedCommand> commands;
+    bool needsRoles = false;
+};
+
+std::string_view StripLeadingSelectors(std::string_view command)
+{
+    std::vector<std::string_view> const words = SplitWordViews(command);
+
+    for (std::string_view word : words)
+    {
+        if (word.front() != '@')
+            return command.substr(word.data() - command.data());
+    }
+
+    return {};
+}
+
+CommandPlan BuildCommandPlan(std::string_view message)
+{
+    CommandPlan plan;
+    std::string_view const prefix = sPlayerbotAIConfig.commandPrefix;
+
+    for (std::string_view command : SplitCommands(message, sPlayerbotAIConfig.commandSeparator))
+    {
+        command = TrimView(command);
+        if (command.empty())
+            continue;
+
+        if (!prefix.empty())
+        {
+            if (command.substr(0, prefix.size()) != prefix)
+                continue;
+
+            command = TrimView(command.substr(prefix.size()));
+            if (command.empty())
+                continue;
+        }
+
+        /* Whatever the recognizer rejects cannot reach a verb for any bot. */
+
+        if (!SubCommandMayContainModuleVerb(command, {}))
+            continue;
+
+        PlannedCommand planned;
+        planned.text = command;
+        planned.commandText = StripLeadingSelectors(command);
+        planned.parsed = ParseBotCommand(planned.commandText);
+        planned.selector = CompileSelectors(planned.text, planned.commandText);
+        plan.needsRoles = plan.needsRoles || planned.selector.requireTank || planned.selector.requireHeal || planned.selector.requireDps;
+        plan.commands.push_back(planned);
+    }
+
+    return plan;
+}
+
 struct ResolvedSpec
 {
     SpecDefinition const* definition = nullptr;
 };
 
-bool ResolveRequestedSpec(uint8 classId, std::string const& requestedProfile, ResolvedSpec& resolved, bool allowRoleSelection = true)
+bool ResolveRequestedSpec(uint8 classId, std::string_view requestedProfile, ResolvedSpec& resolved, bool allowRoleSelection = true)
 {
     auto const& profiles = GetClassSpecProfiles();
     auto const profileIt = profiles.find(classId);
@@ -1342,26 +2292,21 @@ bool ResolveRequestedSpec(uint8 classId, std::string const& requestedProfile, Re
         return false;
 
     ClassSpecProfile const& profile = profileIt->second;
-    std::string const requestedNorm = NormalizeToken(requestedProfile);
+    NormalizedToken const requestedNorm(requestedProfile);
 
     /* First attempt exact aliases; deterministic behavior is easier to trust. */
 
-    for (SpecDefinition const& exact : profile.specs)
+    if (std::string_view const* canonical = SPEC_ALIASES.Find(classId, requestedNorm))
     {
-        for (std::string const& alias : exact.aliases)
-        {
-            if (requestedNorm != NormalizeToken(alias))
-                continue;
-
-            resolved.definition = &exact;
+        resolved.definition = FindSpecDefinition(profile, *canonical);
+        if (resolved.definition)
             return true;
-        }
     }
 
-    if (!allowRoleSelection)
+    if (!allowRoleSelection || !requestedNorm.Valid())
         return false;
 
-    auto const roleIt = profile.roles.find(requestedNorm);
+    auto const roleIt = profile.roles.find(requestedNorm.View());
     if (roleIt == profile.roles.end() || roleIt->second.empty())
         return false;
 
@@ -1373,7 +2318,7 @@ bool ResolveRequestedSpec(uint8 classId, std::string const& requestedProfile, Re
     return resolved.definition != nullptr;
 }
 
-bool ResolveRequestedSpec(Player* bot, std::string const& requestedProfile, ResolvedSpec& resolved, bool allowRoleSelection = true)
+bool ResolveRequestedSpec(Player* bot, std::string_view requestedProfile, ResolvedSpec& resolved, bool allowRoleSelection = true)
 {
     return bot && ResolveRequestedSpec(bot->getClass(), requestedProfile, resolved, allowRoleSelection);
 }
@@ -1507,12 +2452,29 @@ ExpansionCap ResolveSetupExpansionCap(Player* bot, ModuleConfig const& config)
     return ResolveConfiguredExpansionCap(bot, config);
 }
 
+/* Talent node slots: every (tab, row, col) a 3.3.5 tree can hold. */
+
+constexpr uint32 TALENT_NODE_TABS = 3;
+constexpr uint32 TALENT_NODE_ROWS = 11;
+constexpr uint32 TALENT_NODE_COLS = 4;
+constexpr uint32 TALENT_NODE_SLOTS = TALENT_NODE_TABS * TALENT_NODE_ROWS * TALENT_NODE_COLS;
+
+using TalentRankVector = std::array<uint8, TALENT_NODE_SLOTS>;
+
+int GetTalentNodeSlot(uint32 tab, uint32 row, uint32 col)
+{
+    if (tab >= TALENT_NODE_TABS || row >= TALENT_NODE_ROWS || col >= TALENT_NODE_COLS)
+        return -1;
+
+    return static_cast<int>((tab * TALENT_NODE_ROWS + row) * TALENT_NODE_COLS + col);
+}
+
 /* Hard gate for talent nodes when expansion limiting is active.
  * Vanilla allows up to row 6 center node; TBC up to row 8 center node.
  * This prevents helpful commands from inventing time travel.
  */
 
-bool IsAllowedTalentNode(ExpansionCap cap, uint32 row, uint32 col)
+bool IsAllowedTalentNodeByRule(ExpansionCap cap, uint32 row, uint32 col)
 {
     if (cap == ExpansionCap::Vanilla)
         return !(row > 6 || (row == 6 && col != 1));
@@ -1523,107 +2485,290 @@ bool IsAllowedTalentNode(ExpansionCap cap, uint32 row, uint32 col)
     return true;
 }
 
-/* Build the parsed template path beginning from the nearest level that has entries.
- * This mirrors how premade trees are defined incrementally across levels.
- */
-
-std::vector<std::vector<uint32>> BuildTemplatePath(Player* bot, uint8 classId, int specNo)
-{
-    int startLevel = static_cast<int>(bot->GetLevel());
+/* The same gate as one (row, col) bitset per cap, worked out once. */
 
-    /* Step backward to the nearest level with parsed data, then replay forward to 80. */
+using TalentNodeAllowMask = std::bitset<TALENT_NODE_ROWS * TALENT_NODE_COLS>;
 
-    while (startLevel > 1 && startLevel < 80 &&
-           sPlayerbotAIConfig.parsedSpecLinkOrder[classId][specNo][startLevel].empty())
+std::array<TalentNodeAllowMask, 3> const& GetTalentNodeAllowMasks()
+{
+    static std::array<TalentNodeAllowMask, 3> const masks = []()
     {
-        --startLevel;
-    }
+        std::array<TalentNodeAllowMask, 3> built;
+        for (ExpansionCap cap : { ExpansionCap::Wrath, ExpansionCap::TBC, ExpansionCap::Vanilla })
+        {
+            for (uint32 row = 0; row < TALENT_NODE_ROWS; ++row)
+            {
+                for (uint32 col = 0; col < TALENT_NODE_COLS; ++col)
+                    built[static_cast<size_t>(cap)][row * TALENT_NODE_COLS + col] = IsAllowedTalentNodeByRule(cap, row, col);
+            }
+        }
 
-    std::vector<std::vector<uint32>> path;
+        return built;
+    }();
 
-    for (int level = startLevel; level <= 80; ++level)
-    {
-        std::vector<std::vector<uint32>> const& entries = sPlayerbotAIConfig.parsedSpecLinkOrder[classId][specNo][level];
-        path.insert(path.end(), entries.begin(), entries.end());
-    }
+    return masks;
+}
 
-    return path;
+bool IsAllowedTalentNode(ExpansionCap cap, uint32 row, uint32 col)
+{
+    if (row >= TALENT_NODE_ROWS || col >= TALENT_NODE_COLS)
+        return IsAllowedTalentNodeByRule(cap, row, col);
+
+    return GetTalentNodeAllowMasks()[static_cast<size_t>(cap)][row * TALENT_NODE_COLS + col];
 }
 
-uint32 GetPrimaryTalentTab(std::vector<std::vector<uint32>> const& parsedPath)
+/* Talent entries grouped by class, tab page and row.
+ * Leftover-point filling only ever looks at one tree of one class, so the
+ * talent store is walked once and each row keeps its entries in store
+ * order. The DBCs never reload, so neither does the index.
+ */
+
+struct TalentTreeRow
 {
-    std::map<uint32, uint32> pointTotals;
+    std::array<TalentEntry const*, TALENT_NODE_COLS> entries = {};
+    uint8 count = 0;
+};
+
+using TalentTreeIndex = std::array<std::array<std::array<TalentTreeRow, TALENT_NODE_ROWS>, TALENT_NODE_TABS>, MAX_CLASSES>;
 
-    for (std::vector<uint32> const& entry : parsedPath)
+TalentTreeIndex const& GetTalentTreeIndex()
+{
+    static std::unique_ptr<TalentTreeIndex const> const index = []()
     {
-        if (entry.size() < 4)
-            continue;
+        auto built = std::make_unique<TalentTreeIndex>();
 
-        pointTotals[entry[0]] += entry[3];
-    }
+        for (uint32 i = 0; i < sTalentStore.GetNumRows(); ++i)
+        {
+            TalentEntry const* talentInfo = sTalentStore.LookupEntry(i);
+            if (!talentInfo || talentInfo->Row >= TALENT_NODE_ROWS || talentInfo->Col >= TALENT_NODE_COLS)
+                continue;
 
-    uint32 primaryTab = 0;
-    uint32 highestPoints = 0;
+            TalentTabEntry const* talentTabInfo = sTalentTabStore.LookupEntry(talentInfo->TalentTab);
+            if (!talentTabInfo || talentTabInfo->tabpage >= TALENT_NODE_TABS)
+                continue;
 
-    for (auto const& [tab, points] : pointTotals)
-    {
-        if (points <= highestPoints)
-            continue;
+            for (uint32 classId = 1; classId < MAX_CLASSES; ++classId)
+            {
+                if ((talentTabInfo->ClassMask & (1 << (classId - 1))) == 0)
+                    continue;
 
-        primaryTab = tab;
-        highestPoints = points;
-    }
+                TalentTreeRow& row = (*built)[classId][talentTabInfo->tabpage][talentInfo->Row];
+                if (row.count < row.entries.size())
+                    row.entries[row.count++] = talentInfo;
+            }
+        }
 
-    return primaryTab;
+        return std::unique_ptr<TalentTreeIndex const>(std::move(built));
+    }();
+
+    return *index;
 }
 
-/* Some caps do not support glyphs; when in doubt, wipe to a clean state. */
+/* Premade talent templates, flattened.
+ * parsedSpecLinkOrder keeps one vector of vectors per (class, specNo, level),
+ * and every talent decision used to copy the slice it needed into a fresh
+ * nested vector. Each (class, specNo) is now packed once into a contiguous
+ * run of nodes in level order, with the offset where each level starts, so
+ * a template path is just a pointer range. Tables are rebuilt lazily after
+ * a config reload, once playerbots has parsed its premades again.
+ */
 
-void ClearGlyphs(Player* bot)
+struct TalentTemplateNode
 {
-    for (uint32 slotIndex = 0; slotIndex < MAX_GLYPH_SLOT_INDEX; ++slotIndex)
-        bot->SetGlyph(slotIndex, 0, true);
+    uint8 tab = 0;
+    uint8 row = 0;
+    uint8 col = 0;
+    uint8 rank = 0;
+    uint8 level = 0;
+};
 
-    bot->SendTalentsInfoData(false);
-}
+/* suffixRanks[level] holds, per node slot, 1 + the highest rank the path
+ * starting at that level asks for, or 0 when the path never names the node.
+ */
 
-void FillRemainingTalentsInTree(Player* bot, uint32 specTab, ExpansionCap cap)
+struct TalentTemplateTable
 {
-    if (!bot || bot->GetFreeTalentPoints() == 0)
-        return;
+    std::vector<TalentTemplateNode> nodes;
+    std::array<uint32, 82> levelStart = {};
+    std::array<bool, 81> levelHasEntries = {};
+    std::vector<TalentRankVector> suffixRanks;
+};
+
+struct TalentTemplatePath
+{
+    TalentTemplateNode const* first = nullptr;
+    TalentTemplateNode const* last = nullptr;
 
-    uint32 const classMask = bot->getClassMask();
-    std::map<uint32, std::vector<TalentEntry const*>> spellsByRow;
+    TalentTemplateNode const* begin() const { return first; }
+    TalentTemplateNode const* end() const { return last; }
+    bool empty() const { return first == last; }
+};
+
+std::vector<TalentTemplateTable>& GetTalentTemplateTables()
+{
+    static std::vector<TalentTemplateTable> tables;
+    return tables;
+}
 
-    for (uint32 i = 0; i < sTalentStore.GetNumRows(); ++i)
+void ClearTalentTemplateTables()
+{
+    GetTalentTemplateTables().clear();
+}
+
+TalentTemplateTable const& GetTalentTemplateTable(uint8 classId, int specNo)
+{
+    std::vector<TalentTemplateTable>& tables = GetTalentTemplateTables();
+    if (tables.empty())
     {
-        TalentEntry const* talentInfo = sTalentStore.LookupEntry(i);
-        if (!talentInfo || !IsAllowedTalentNode(cap, talentInfo->Row, talentInfo->Col))
-            continue;
+        tables.resize(MAX_CLASSES * MAX_SPECNO);
 
-        TalentTabEntry const* talentTabInfo = sTalentTabStore.LookupEntry(talentInfo->TalentTab);
-        if (!talentTabInfo || talentTabInfo->tabpage != specTab)
-            continue;
+        for (uint8 tableClass = 0; tableClass < MAX_CLASSES; ++tableClass)
+        {
+            for (uint32 tableSpec = 0; tableSpec < MAX_SPECNO; ++tableSpec)
+            {
+                TalentTemplateTable& table = tables[tableClass * MAX_SPECNO + tableSpec];
+
+                for (uint32 level = 0; level <= 80; ++level)
+                {
+                    std::vector<std::vector<uint32>> const& entries =
+                        sPlayerbotAIConfig.parsedSpecLinkOrder[tableClass][tableSpec][level];
+
+                    table.levelStart[level] = static_cast<uint32>(table.nodes.size());
+                    table.levelHasEntries[level] = !entries.empty();
+
+                    for (std::vector<uint32> const& entry : entries)
+                    {
+                        /* Short or out-of-range entries were skipped by every reader anyway. */
+
+                        if (entry.size() < 4 || entry[0] > 0xFF || entry[1] > 0xFF || entry[2] > 0xFF || entry[3] > 0xFF)
+                            continue;
+
+                        table.nodes.push_back({ static_cast<uint8>(entry[0]), static_cast<uint8>(entry[1]),
+                                                static_cast<uint8>(entry[2]), static_cast<uint8>(entry[3]),
+                                                static_cast<uint8>(level) });
+                    }
+                }
+
+                table.levelStart[81] = static_cast<uint32>(table.nodes.size());
+
+                if (table.nodes.empty())
+                    continue;
+
+                table.suffixRanks.assign(82, TalentRankVector{});
+                for (int level = 80; level >= 0; --level)
+                {
+                    table.suffixRanks[level] = table.suffixRanks[level + 1];
+
+                    for (uint32 index = table.levelStart[level]; index < table.levelStart[level + 1]; ++index)
+                    {
+                        TalentTemplateNode const& node = table.nodes[index];
+                        int const slot = GetTalentNodeSlot(node.tab, node.row, node.col);
+                        if (slot < 0 || node.rank == 0xFF)
+                            continue;
+
+                        uint8& encoded = table.suffixRanks[level][slot];
+                        encoded = std::max<uint8>(encoded, node.rank + 1);
+                    }
+                }
+            }
+        }
+    }
+
+    return tables[classId * MAX_SPECNO + specNo];
+}
+
+/* Template path beginning from the nearest level that has entries.
+ * This mirrors how premade trees are defined incrementally across levels.
+ */
+
+int FindTemplateStartLevel(TalentTemplateTable const& table, Player* bot)
+{
+    int startLevel = static_cast<int>(bot->GetLevel());
+
+    /* Step backward to the nearest level with parsed data, then replay forward to 80. */
+
+    while (startLevel > 1 && startLevel < 80 && !table.levelHasEntries[startLevel])
+        --startLevel;
+
+    return std::clamp(startLevel, 0, 81);
+}
+
+TalentTemplatePath BuildTemplatePath(Player* bot, uint8 classId, int specNo)
+{
+    TalentTemplateTable const& table = GetTalentTemplateTable(classId, specNo);
+    int const startLevel = FindTemplateStartLevel(table, bot);
+
+    TalentTemplatePath path;
+    path.first = table.nodes.data() + table.levelStart[startLevel];
+    path.last = table.nodes.data() + table.nodes.size();
+    return path;
+}
 
-        if ((classMask & talentTabInfo->ClassMask) == 0)
+uint32 GetPrimaryTalentTab(TalentTemplatePath const& parsedPath)
+{
+    std::array<uint32, 256> pointTotals = {};
+
+    for (TalentTemplateNode const& node : parsedPath)
+        pointTotals[node.tab] += node.rank;
+
+    uint32 primaryTab = 0;
+    uint32 highestPoints = 0;
+
+    for (uint32 tab = 0; tab < pointTotals.size(); ++tab)
+    {
+        if (pointTotals[tab] <= highestPoints)
             continue;
 
-        spellsByRow[talentInfo->Row].push_back(talentInfo);
+        primaryTab = tab;
+        highestPoints = pointTotals[tab];
     }
 
+    return primaryTab;
+}
+
+/* Some caps do not support glyphs; when in doubt, wipe to a clean state. */
+
+void ClearGlyphs(Player* bot)
+{
+    for (uint32 slotIndex = 0; slotIndex < MAX_GLYPH_SLOT_INDEX; ++slotIndex)
+        bot->SetGlyph(slotIndex, 0, true);
+
+    bot->SendTalentsInfoData(false);
+}
+
+void FillRemainingTalentsInTree(Player* bot, uint32 specTab, ExpansionCap cap)
+{
+    if (!bot || bot->GetFreeTalentPoints() == 0)
+        return;
+
+    uint8 const classId = bot->getClass();
+    if (classId == 0 || classId >= MAX_CLASSES || specTab >= TALENT_NODE_TABS)
+        return;
+
+    TalentNodeAllowMask const& allowed = GetTalentNodeAllowMasks()[static_cast<size_t>(cap)];
     uint32 freePoints = bot->GetFreeTalentPoints();
 
-    for (auto& rowEntry : spellsByRow)
+    for (uint32 rowIndex = 0; rowIndex < TALENT_NODE_ROWS; ++rowIndex)
     {
-        std::vector<TalentEntry const*>& spells = rowEntry.second;
-        if (spells.empty())
+        TalentTreeRow const& treeRow = GetTalentTreeIndex()[classId][specTab][rowIndex];
+
+        std::array<TalentEntry const*, TALENT_NODE_COLS> spells = {};
+        uint32 spellCount = 0;
+        for (uint32 i = 0; i < treeRow.count; ++i)
+        {
+            TalentEntry const* talentInfo = treeRow.entries[i];
+            if (allowed[rowIndex * TALENT_NODE_COLS + talentInfo->Col])
+                spells[spellCount++] = talentInfo;
+        }
+
+        if (spellCount == 0)
             continue;
 
         int attemptCount = 0;
-        while (!spells.empty() && static_cast<int>(freePoints) - static_cast<int>(bot->GetFreeTalentPoints()) < 5 &&
+        while (spellCount && static_cast<int>(freePoints) - static_cast<int>(bot->GetFreeTalentPoints()) < 5 &&
                attemptCount++ < 3 && bot->GetFreeTalentPoints())
         {
-            uint32 const index = urand(0, spells.size() - 1);
+            uint32 const index = urand(0, spellCount - 1);
             TalentEntry const* talentInfo = spells[index];
             int maxRank = 0;
 
@@ -1642,7 +2787,8 @@ void FillRemainingTalentsInTree(Player* bot, uint32 specTab, ExpansionCap cap)
             }
 
             bot->LearnTalent(talentInfo->TalentID, maxRank);
-            spells.erase(spells.begin() + index);
+            std::copy(spells.begin() + index + 1, spells.begin() + spellCount, spells.begin() + index);
+            --spellCount;
         }
 
         freePoints = bot->GetFreeTalentPoints();
@@ -1651,7 +2797,7 @@ void FillRemainingTalentsInTree(Player* bot, uint32 specTab, ExpansionCap cap)
     }
 }
 
-void FillRemainingTalentPoints(Player* bot, std::vector<std::vector<uint32>> const& parsedPath, ExpansionCap cap)
+void FillRemainingTalentPoints(Player* bot, TalentTemplatePath const& parsedPath, ExpansionCap cap)
 {
     if (!bot || parsedPath.empty() || bot->GetFreeTalentPoints() == 0)
         return;
@@ -1669,7 +2815,7 @@ void FillRemainingTalentPoints(Player* bot, std::vector<std::vector<uint32>> con
 
 bool ApplySpecTalents(Player* bot, int specNo, ExpansionCap cap)
 {
-    std::vector<std::vector<uint32>> parsedPath = BuildTemplatePath(bot, bot->getClass(), specNo);
+    TalentTemplatePath const parsedPath = BuildTemplatePath(bot, bot->getClass(), specNo);
 
     /* No parsed path means we fall back to the legacy spec initializer. */
 
@@ -1680,22 +2826,19 @@ bool ApplySpecTalents(Player* bot, int specNo, ExpansionCap cap)
     }
 
     std::vector<std::vector<uint32>> filtered;
-    filtered.reserve(parsedPath.size());
+    filtered.reserve(parsedPath.end() - parsedPath.begin());
 
-    /* Filter template nodes through the current expansion cap before applying. */
+    /* Filter template nodes through the current expansion cap before applying.
+     * The upstream initializer still wants its own nested format, so this is
+     * the one place a node becomes a vector again.
+     */
 
-    for (std::vector<uint32> const& entry : parsedPath)
+    for (TalentTemplateNode const& node : parsedPath)
     {
-        if (entry.size() < 4)
-            continue;
-
-        uint32 row = entry[1];
-        uint32 col = entry[2];
-
-        if (!IsAllowedTalentNode(cap, row, col))
+        if (!IsAllowedTalentNode(cap, node.row, node.col))
             continue;
 
-        filtered.push_back(entry);
+        filtered.push_back({ node.tab, node.row, node.col, node.rank });
     }
 
     /* If filtering removed everything, fallback prevents a talentless existential crisis. */
@@ -1712,16 +2855,17 @@ bool ApplySpecTalents(Player* bot, int specNo, ExpansionCap cap)
     return true;
 }
 
-uint32 EncodeTalentNodeKey(uint32 tab, uint32 row, uint32 col)
-{
-    return (tab << 16) | (row << 8) | col;
-}
+/* Current-spec detection.
+ * The bot's talents and every candidate template are laid out as the same
+ * fixed rank vector, so scoring a spec is one pass of min/compare over 132
+ * bytes. The answer is kept per bot and reused until a cheap signature of
+ * its talent map, level or active spec changes.
+ */
 
-std::unordered_map<uint32, uint32> BuildCurrentTalentRanks(Player* bot)
+bool BuildCurrentTalentRanks(Player* bot, TalentRankVector& ranks)
 {
-    std::unordered_map<uint32, uint32> ranks;
-    if (!bot)
-        return ranks;
+    ranks.fill(0);
+    bool any = false;
 
     PlayerTalentMap const& talentMap = bot->GetTalentMap();
     for (PlayerTalentMap::const_iterator itr = talentMap.begin(); itr != talentMap.end(); ++itr)
@@ -1742,50 +2886,85 @@ std::unordered_map<uint32, uint32> BuildCurrentTalentRanks(Player* bot)
         if (!talentTabInfo)
             continue;
 
-        SpellInfo const* spellInfo = sSpellMgr->GetSpellInfo(spellId);
-        uint32 const rank = spellInfo ? std::max<uint32>(1, spellInfo->GetRank()) : 1;
-        uint32 const key = EncodeTalentNodeKey(talentTabInfo->tabpage, talentInfo->Row, talentInfo->Col);
+        int const slot = GetTalentNodeSlot(talentTabInfo->tabpage, talentInfo->Row, talentInfo->Col);
+        if (slot < 0)
+            continue;
 
-        auto const [it, inserted] = ranks.try_emplace(key, rank);
-        if (!inserted)
-            it->second = std::max(it->second, rank);
+        SpellInfo const* spellInfo = sSpellMgr->GetSpellInfo(spellId);
+        uint32 const rank = spellInfo ? std::clamp<uint32>(spellInfo->GetRank(), 1, 0xFF) : 1;
+        ranks[slot] = std::max<uint8>(ranks[slot], static_cast<uint8>(rank));
+        any = true;
     }
 
-    return ranks;
+    return any;
 }
 
-std::unordered_map<uint32, uint32> BuildTemplateTalentRanks(Player* bot, int specNo)
+uint64 ComputeTalentSignature(Player* bot)
 {
-    std::unordered_map<uint32, uint32> ranks;
-    if (!bot || specNo < 0)
-        return ranks;
+    uint64 signature = 1469598103934665603ULL;
+    auto const mix = [&signature](uint64 value)
+    {
+        signature ^= value;
+        signature *= 1099511628211ULL;
+    };
+
+    mix(bot->GetLevel());
+    mix(bot->GetActiveSpec());
+
+    /* The talent map is unordered, so each talent is hashed on its own and the
+     * results summed; bots with the same talents get the same signature no
+     * matter how their maps were filled.
+     */
 
-    for (std::vector<uint32> const& entry : BuildTemplatePath(bot, bot->getClass(), specNo))
+    uint64 talentSum = 0;
+    PlayerTalentMap const& talentMap = bot->GetTalentMap();
+    for (PlayerTalentMap::const_iterator itr = talentMap.begin(); itr != talentMap.end(); ++itr)
     {
-        if (entry.size() < 4)
+        if ((bot->GetActiveSpecMask() & itr->second->specMask) == 0)
             continue;
 
-        uint32 const key = EncodeTalentNodeKey(entry[0], entry[1], entry[2]);
-        auto const [it, inserted] = ranks.try_emplace(key, entry[3]);
-        if (!inserted)
-            it->second = std::max(it->second, entry[3]);
+        uint64 talentHash = itr->first + 0x9E3779B97F4A7C15ULL;
+        talentHash = (talentHash ^ (talentHash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        talentHash = (talentHash ^ (talentHash >> 27)) * 0x94D049BB133111EBULL;
+        talentSum += talentHash ^ (talentHash >> 31);
     }
 
-    return ranks;
+    mix(talentSum);
+    return signature;
 }
 
-int FindBestCurrentSpecNo(Player* bot)
+struct CurrentSpecCacheEntry
 {
-    if (!bot)
-        return -1;
+    uint64 signature = 0;
+    int specNo = -1;
+};
+
+std::unordered_map<ObjectGuid, CurrentSpecCacheEntry>& GetCurrentSpecCache()
+{
+    static std::unordered_map<ObjectGuid, CurrentSpecCacheEntry> cache;
+    return cache;
+}
+
+void ForgetCurrentSpec(Player* bot)
+{
+    if (bot)
+        GetCurrentSpecCache().erase(bot->GetGUID());
+}
+
+void ClearCurrentSpecCache()
+{
+    GetCurrentSpecCache().clear();
+}
 
+int ScoreCurrentSpecNo(Player* bot)
+{
     ClassSpecMap const& profiles = GetClassSpecProfiles();
     auto const profileIt = profiles.find(bot->getClass());
     if (profileIt == profiles.end())
         return -1;
 
-    std::unordered_map<uint32, uint32> const currentRanks = BuildCurrentTalentRanks(bot);
-    if (currentRanks.empty())
+    TalentRankVector currentRanks;
+    if (!BuildCurrentTalentRanks(bot, currentRanks))
         return -1;
 
     int bestSpecNo = -1;
@@ -1798,25 +2977,33 @@ int FindBestCurrentSpecNo(Player* bot)
         if (specNo < 0)
             continue;
 
-        std::unordered_map<uint32, uint32> const templateRanks = BuildTemplateTalentRanks(bot, specNo);
-        if (templateRanks.empty())
+        TalentTemplateTable const& table = GetTalentTemplateTable(bot->getClass(), specNo);
+        if (table.suffixRanks.empty())
             continue;
 
+        TalentRankVector const& templateRanks = table.suffixRanks[FindTemplateStartLevel(table, bot)];
+
         uint32 score = 0;
         uint32 matchedNodes = 0;
+        bool anyTemplateNode = false;
 
-        for (auto const& [nodeKey, currentRank] : currentRanks)
+        for (uint32 slot = 0; slot < TALENT_NODE_SLOTS; ++slot)
         {
-            auto const templateIt = templateRanks.find(nodeKey);
-            if (templateIt == templateRanks.end())
+            uint32 const encoded = templateRanks[slot];
+            anyTemplateNode |= encoded != 0;
+
+            uint32 const currentRank = currentRanks[slot];
+            if (!currentRank || !encoded)
                 continue;
 
+            uint32 const templateRank = encoded - 1;
             ++matchedNodes;
-            score += std::min(currentRank, templateIt->second);
-            if (currentRank == templateIt->second)
-                ++score;
+            score += std::min(currentRank, templateRank) + (currentRank == templateRank ? 1 : 0);
         }
 
+        if (!anyTemplateNode)
+            continue;
+
         if (score > bestScore || (score == bestScore && matchedNodes > bestMatchedNodes))
         {
             bestSpecNo = specNo;
@@ -1828,6 +3015,21 @@ int FindBestCurrentSpecNo(Player* bot)
     return bestScore == 0 ? -1 : bestSpecNo;
 }
 
+int FindBestCurrentSpecNo(Player* bot)
+{
+    if (!bot)
+        return -1;
+
+    uint64 const signature = ComputeTalentSignature(bot);
+    CurrentSpecCacheEntry& entry = GetCurrentSpecCache()[bot->GetGUID()];
+    if (entry.signature == signature && signature != 0)
+        return entry.specNo;
+
+    entry.signature = signature;
+    entry.specNo = ScoreCurrentSpecNo(bot);
+    return entry.specNo;
+}
+
 SpecDefinition const* FindSpecDefinitionForSpecNo(Player* bot, int specNo)
 {
     if (!bot || specNo < 0)
@@ -1835,16 +3037,15 @@ SpecDefinition const* FindSpecDefinitionForSpecNo(Player* bot, int specNo)
 
     ClassSpecMap const& profiles = GetClassSpecProfiles();
     auto const profileIt = profiles.find(bot->getClass());
-    if (profileIt == profiles.end())
+    SpecNoTable const* table = GetSpecNoTable(bot->getClass());
+    if (profileIt == profiles.end() || !table || specNo >= static_cast<int>(MAX_SPECNO))
         return nullptr;
 
-    for (SpecDefinition const& spec : profileIt->second.specs)
-    {
-        if (FindSpecNoForDefinition(bot->getClass(), spec) == specNo)
-            return &spec;
-    }
+    int const definitionIndex = table->definitionBySpecNo[specNo];
+    if (definitionIndex < 0)
+        return nullptr;
 
-    return nullptr;
+    return &profileIt->second.specs[definitionIndex];
 }
 
 bool ResolveCurrentSpec(Player* bot, ResolvedSpec& resolved)
@@ -2692,42 +3893,6 @@ void DestroyOldGear(Player* bot)
     bot->SetAmmo(0);
 }
 
-/* Validate that equipped gear is reasonably close to target average ilvl and
- * does not include low-quality junk.
- */
-
-bool IsGearWithinTargetBand(Player* bot, float targetAverageIlvl, ModuleConfig const& config)
-{
-    if (!bot || targetAverageIlvl <= 0.0f)
-        return true;
-
-    float const lowerBound = std::max(1.0f, targetAverageIlvl * config.gearValidationLowerRatio);
-    float const upperBound = targetAverageIlvl * config.gearValidationUpperRatio;
-
-    for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
-    {
-        if (slot == EQUIPMENT_SLOT_BODY || slot == EQUIPMENT_SLOT_TABARD)
-            continue;
-
-        Item* item = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
-        if (!item)
-            continue;
-
-        ItemTemplate const* proto = item->GetTemplate();
-        if (!proto)
-            continue;
-
-        if (proto->Quality <= ITEM_QUALITY_NORMAL)
-            return false;
-
-        float const itemLevel = static_cast<float>(proto->ItemLevel);
-        if (itemLevel < lowerBound || itemLevel > upperBound)
-            return false;
-    }
-
-    return true;
-}
-
 bool IsItemLevelWithinTargetBand(uint32 itemLevel, float targetAverageIlvl, ModuleConfig const& config)
 {
     if (targetAverageIlvl <= 0.0f)
@@ -2850,27 +4015,6 @@ bool IsValidTargetBandGearItem(Player* bot, uint8 slot, ItemTemplate const* prot
     return IsValidGearItemForTargetBand(proto, targetAverageIlvl, config);
 }
 
-bool IsSpecPlayerGearWithinTargetBand(Player* bot, float targetAverageIlvl, ModuleConfig const& config)
-{
-    if (!bot || targetAverageIlvl <= 0.0f)
-        return true;
-
-    for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
-    {
-        if (slot == EQUIPMENT_SLOT_BODY || slot == EQUIPMENT_SLOT_TABARD)
-            continue;
-
-        Item* item = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
-        if (!item)
-            continue;
-
-        if (!IsValidTargetBandGearItem(bot, slot, item->GetTemplate(), targetAverageIlvl, config, true))
-            return false;
-    }
-
-    return true;
-}
-
 bool IsPrimaryArmorSlot(uint8 slot)
 {
     switch (slot)
@@ -2991,102 +4135,550 @@ bool PassesExpansionLimitFilter(Player* bot, uint32 itemId)
     return true;
 }
 
-bool CanEquipUnseenItemForModule(Player* bot, uint8 slot, uint16& dest, uint32 itemId)
+/* Gear candidate index.
+ * GetCachedEquipments hands back every item for a (required level, inventory
+ * type) pair, and the band passes used to fetch and filter each template in
+ * turn. The module now folds each pair once into groups by item class,
+ * subclass and quality, sorted by item level, so a band query is a binary
+ * search per matching group. The index is only a prefilter: callers still run
+ * their full checks on what it returns, and candidates come back in cache
+ * order so ties are still won by the same item as before.
+ * Buckets are built lazily because the playerbots item cache may not be ready
+ * when the module loads; an empty answer is never memoized for that reason.
+ */
+
+struct GearCandidate
 {
-    dest = 0;
+    uint32 itemId = 0;
+    uint32 cacheOrder = 0;
+    uint32 itemLevel = 0;
+};
 
-    if (Item* testItem = Item::CreateItem(itemId, 1, bot, false, 0, true))
-    {
-        PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot);
-        InventoryResult result = botAI ? botAI->CanEquipItem(slot, dest, testItem, true, true)
-                                       : bot->CanEquipItem(slot, dest, testItem, true, true);
-        testItem->RemoveFromUpdateQueueOf(bot);
-        delete testItem;
-        return result == EQUIP_ERR_OK;
-    }
+struct GearCandidateGroup
+{
+    uint32 itemClass = 0;
+    uint32 subClass = 0;
+    uint32 quality = 0;
+    std::vector<GearCandidate> candidates;
+};
 
-    return false;
-}
+using GearCandidateBucket = std::vector<GearCandidateGroup>;
 
-void EquipPreferredArmorForSlot(Player* bot, StatsWeightCalculator& calculator, uint8 slot, uint32 preferredSubClass,
-                                uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl,
-                                ModuleConfig const* config, bool applySpecPlayerRestrictions = false, uint8 levelSearchWindow = 10)
+struct GearCandidateQuery
 {
-    std::vector<InventoryType> const inventoryTypes = GetArmorInventoryTypesForSlot(slot);
-    if (inventoryTypes.empty())
-        return;
+    bool armorOnly = false;
+    bool anySubClass = true;
+    uint32 subClass = 0;
+    uint32 minQuality = ITEM_QUALITY_POOR;
+    uint32 maxQuality = ITEM_QUALITY_ARTIFACT;
+    bool bounded = false;
+    float lowerIlvl = 0.0f;
+    float upperIlvl = 0.0f;
+};
 
-    int32 const level = static_cast<int32>(bot->GetLevel());
-    int32 const minLevel = std::max(level - std::min(level, static_cast<int32>(levelSearchWindow)), 1);
+GearCandidateBucket const& GetGearCandidateBucket(uint32 requiredLevel, InventoryType inventoryType)
+{
+    static std::unordered_map<uint32, GearCandidateBucket> buckets;
+    static GearCandidateBucket const emptyBucket;
 
-    float bestScore = -1.0f;
-    uint32 bestItemId = 0;
-    uint16 bestDest = 0;
+    uint32 const key = (requiredLevel << 8) | static_cast<uint32>(inventoryType);
+    auto const found = buckets.find(key);
+    if (found != buckets.end())
+        return found->second;
 
-    for (int32 requiredLevel = level; requiredLevel >= minLevel; --requiredLevel)
+    GearCandidateBucket bucket;
+    std::map<std::tuple<uint32, uint32, uint32>, size_t> groupIndex;
+    uint32 cacheOrder = 0;
+
+    for (uint32 itemId : sRandomItemMgr.GetCachedEquipments(requiredLevel, inventoryType))
     {
-        for (InventoryType inventoryType : inventoryTypes)
+        ItemTemplate const* proto = sObjectMgr->GetItemTemplate(itemId);
+        if (!proto || (proto->Class != ITEM_CLASS_WEAPON && proto->Class != ITEM_CLASS_ARMOR))
         {
-            for (uint32 itemId : sRandomItemMgr.GetCachedEquipments(requiredLevel, inventoryType))
-            {
-                if (!PassesExpansionLimitFilter(bot, itemId))
-                    continue;
+            ++cacheOrder;
+            continue;
+        }
 
-                ItemTemplate const* proto = sObjectMgr->GetItemTemplate(itemId);
-                if (!proto)
-                    continue;
+        auto const groupKey = std::make_tuple(proto->Class, proto->SubClass, proto->Quality);
+        auto groupIt = groupIndex.find(groupKey);
+        if (groupIt == groupIndex.end())
+        {
+            GearCandidateGroup group;
+            group.itemClass = proto->Class;
+            group.subClass = proto->SubClass;
+            group.quality = proto->Quality;
+            bucket.push_back(std::move(group));
+            groupIt = groupIndex.emplace(groupKey, bucket.size() - 1).first;
+        }
 
-                if (proto->Class != ITEM_CLASS_ARMOR || proto->SubClass != preferredSubClass)
-                    continue;
+        bucket[groupIt->second].candidates.push_back({ itemId, cacheOrder++, proto->ItemLevel });
+    }
 
-                if (!IsTierArmorSubClass(proto->SubClass))
-                    continue;
+    if (bucket.empty())
+        return emptyBucket;
 
-                if (proto->Quality > qualityLimit)
-                    continue;
+    for (GearCandidateGroup& group : bucket)
+    {
+        std::sort(group.candidates.begin(), group.candidates.end(), [](GearCandidate const& left, GearCandidate const& right)
+        {
+            return left.itemLevel != right.itemLevel ? left.itemLevel < right.itemLevel : left.cacheOrder < right.cacheOrder;
+        });
+    }
 
-                if (proto->RequiredLevel > bot->GetLevel() || proto->Duration != 0 || proto->Bonding == BIND_QUEST_ITEM)
-                    continue;
+    return buckets.emplace(key, std::move(bucket)).first->second;
+}
 
-                if (config && !IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, *config, applySpecPlayerRestrictions))
-                    continue;
+GearCandidateQuery BuildGearCandidateQuery(uint32 minQuality, uint32 qualityLimit, float targetAverageIlvl, ModuleConfig const* config)
+{
+    GearCandidateQuery query;
+    query.minQuality = minQuality;
+    query.maxQuality = qualityLimit;
 
-                uint16 dest = 0;
-                if (!CanEquipUnseenItemForModule(bot, slot, dest, itemId))
-                    continue;
+    /* Same bounds as IsItemLevelWithinTargetBand, compared in float the same way. */
 
-                float const score = calculator.CalculateItem(itemId);
-                if (score > bestScore)
-                {
-                    bestScore = score;
-                    bestItemId = itemId;
-                    bestDest = dest;
-                }
-            }
-        }
+    if (config && targetAverageIlvl > 0.0f)
+    {
+        query.bounded = true;
+        query.lowerIlvl = std::max(1.0f, targetAverageIlvl * config->gearValidationLowerRatio);
+        query.upperIlvl = targetAverageIlvl * config->gearValidationUpperRatio;
     }
 
-    if (bestItemId == 0)
-        return;
+    return query;
+}
 
-    if (Item* oldItem = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
-        bot->DestroyItem(INVENTORY_SLOT_BAG_0, slot, true);
+void CollectGearCandidates(GearCandidateBucket const& bucket, GearCandidateQuery const& query, std::vector<GearCandidate const*>& out)
+{
+    out.clear();
 
-    if (bot->EquipNewItem(bestDest, bestItemId, true))
+    for (GearCandidateGroup const& group : bucket)
+    {
+        if (query.armorOnly && group.itemClass != ITEM_CLASS_ARMOR)
+            continue;
+
+        if (!query.anySubClass && group.subClass != query.subClass)
+            continue;
+
+        if (group.quality < query.minQuality || group.quality > query.maxQuality)
+            continue;
+
+        auto begin = group.candidates.begin();
+        auto end = group.candidates.end();
+        if (query.bounded)
+        {
+            begin = std::partition_point(begin, end, [&query](GearCandidate const& candidate)
+            {
+                return static_cast<float>(candidate.itemLevel) < query.lowerIlvl;
+            });
+            end = std::partition_point(begin, end, [&query](GearCandidate const& candidate)
+            {
+                return static_cast<float>(candidate.itemLevel) <= query.upperIlvl;
+            });
+        }
+
+        for (auto itr = begin; itr != end; ++itr)
+            out.push_back(&*itr);
+    }
+
+    std::sort(out.begin(), out.end(), [](GearCandidate const* left, GearCandidate const* right)
+    {
+        return left->cacheOrder < right->cacheOrder;
+    });
+}
+
+bool CanEquipUnseenItemForModule(Player* bot, uint8 slot, uint16& dest, uint32 itemId)
+{
+    dest = 0;
+
+    if (Item* testItem = Item::CreateItem(itemId, 1, bot, false, 0, true))
+    {
+        PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot);
+        InventoryResult result = botAI ? botAI->CanEquipItem(slot, dest, testItem, true, true)
+                                       : bot->CanEquipItem(slot, dest, testItem, true, true);
+        testItem->RemoveFromUpdateQueueOf(bot);
+        delete testItem;
+        return result == EQUIP_ERR_OK;
+    }
+
+    return false;
+}
+
+/* Static equip check.
+ * CanEquipUnseenItemForModule builds a throwaway Item for every question,
+ * which is a lot of allocation for a gear pass that mostly hears "no".
+ * The snapshot below holds what the core looks at that cannot change during
+ * a gear pass, and CouldEquipItem only answers "no" when the core would
+ * certainly agree. Everything it lets through is scored, and the real check
+ * runs only while walking the ranking from the top, so normally once.
+ */
+
+struct BotEquipCapabilities
+{
+    uint32 classMask = 0;
+    uint32 raceMask = 0;
+    uint32 level = 0;
+    bool canDualWield = false;
+    bool canTitanGrip = false;
+    std::unordered_map<uint32, uint16> skillValues;
+};
+
+uint32 GetItemProficiencySkill(ItemTemplate const* proto)
+{
+    if (proto->Class == ITEM_CLASS_WEAPON)
+    {
+        switch (proto->SubClass)
+        {
+            case ITEM_SUBCLASS_WEAPON_AXE: return SKILL_AXES;
+            case ITEM_SUBCLASS_WEAPON_AXE2: return SKILL_2H_AXES;
+            case ITEM_SUBCLASS_WEAPON_BOW: return SKILL_BOWS;
+            case ITEM_SUBCLASS_WEAPON_GUN: return SKILL_GUNS;
+            case ITEM_SUBCLASS_WEAPON_MACE: return SKILL_MACES;
+            case ITEM_SUBCLASS_WEAPON_MACE2: return SKILL_2H_MACES;
+            case ITEM_SUBCLASS_WEAPON_POLEARM: return SKILL_POLEARMS;
+            case ITEM_SUBCLASS_WEAPON_SWORD: return SKILL_SWORDS;
+            case ITEM_SUBCLASS_WEAPON_SWORD2: return SKILL_2H_SWORDS;
+            case ITEM_SUBCLASS_WEAPON_STAFF: return SKILL_STAVES;
+            case ITEM_SUBCLASS_WEAPON_FIST: return SKILL_FIST_WEAPONS;
+            case ITEM_SUBCLASS_WEAPON_DAGGER: return SKILL_DAGGERS;
+            case ITEM_SUBCLASS_WEAPON_THROWN: return SKILL_THROWN;
+            case ITEM_SUBCLASS_WEAPON_CROSSBOW: return SKILL_CROSSBOWS;
+            case ITEM_SUBCLASS_WEAPON_WAND: return SKILL_WANDS;
+            case ITEM_SUBCLASS_WEAPON_FISHING_POLE: return SKILL_FISHING;
+            default: return 0;
+        }
+    }
+
+    if (proto->Class == ITEM_CLASS_ARMOR)
+    {
+        switch (proto->SubClass)
+        {
+            case ITEM_SUBCLASS_ARMOR_CLOTH: return SKILL_CLOTH;
+            case ITEM_SUBCLASS_ARMOR_LEATHER: return SKILL_LEATHER;
+            case ITEM_SUBCLASS_ARMOR_MAIL: return SKILL_MAIL;
+            case ITEM_SUBCLASS_ARMOR_PLATE: return SKILL_PLATE_MAIL;
+            case ITEM_SUBCLASS_ARMOR_SHIELD: return SKILL_SHIELD;
+            default: return 0;
+        }
+    }
+
+    return 0;
+}
+
+BotEquipCapabilities BuildBotEquipCapabilities(Player* bot)
+{
+    BotEquipCapabilities capabilities;
+    capabilities.classMask = bot->getClassMask();
+    capabilities.raceMask = bot->getRaceMask();
+    capabilities.level = bot->GetLevel();
+    capabilities.canDualWield = bot->CanDualWield();
+    capabilities.canTitanGrip = bot->CanTitanGrip();
+
+    static std::array<uint16, 20> const proficiencySkillIds = {
+        SKILL_AXES, SKILL_2H_AXES, SKILL_BOWS, SKILL_GUNS, SKILL_MACES, SKILL_2H_MACES, SKILL_POLEARMS,
+        SKILL_SWORDS, SKILL_2H_SWORDS, SKILL_STAVES, SKILL_FIST_WEAPONS, SKILL_DAGGERS, SKILL_THROWN,
+        SKILL_CROSSBOWS, SKILL_WANDS, SKILL_CLOTH, SKILL_LEATHER, SKILL_MAIL, SKILL_PLATE_MAIL, SKILL_SHIELD
+    };
+
+    for (uint16 skillId : proficiencySkillIds)
+        capabilities.skillValues[skillId] = bot->GetSkillValue(skillId);
+
+    for (uint16 skillId : GetPrimaryProfessionSkillIds())
+        capabilities.skillValues[skillId] = bot->GetSkillValue(skillId);
+
+    for (uint16 skillId : GetSecondaryProfessionSkillIds())
+        capabilities.skillValues[skillId] = bot->GetSkillValue(skillId);
+
+    return capabilities;
+}
+
+bool CouldEquipItem(BotEquipCapabilities const& capabilities, uint8 slot, ItemTemplate const* proto)
+{
+    if (!proto)
+        return false;
+
+    if ((static_cast<uint32>(proto->AllowableClass) & capabilities.classMask) == 0 ||
+        (static_cast<uint32>(proto->AllowableRace) & capabilities.raceMask) == 0)
+    {
+        return false;
+    }
+
+    if (proto->RequiredLevel > capabilities.level)
+        return false;
+
+    /* Skills we did not snapshot are left for the real check to judge. */
+
+    auto const skillValue = [&capabilities](uint32 skillId) -> int32
+    {
+        auto const found = capabilities.skillValues.find(skillId);
+        return found != capabilities.skillValues.end() ? found->second : -1;
+    };
+
+    if (proto->RequiredSkill)
+    {
+        int32 const value = skillValue(proto->RequiredSkill);
+        if (value == 0 || (value > 0 && static_cast<uint32>(value) < proto->RequiredSkillRank))
+            return false;
+    }
+
+    /* Heirloom armor morphs into whatever the wearer can use, so the core skips it too. */
+
+    bool const heirloomArmor = proto->Quality == ITEM_QUALITY_HEIRLOOM && proto->Class == ITEM_CLASS_ARMOR;
+    uint32 const proficiencySkill = GetItemProficiencySkill(proto);
+    if (proficiencySkill && !heirloomArmor && skillValue(proficiencySkill) == 0)
+        return false;
+
+    if (slot == EQUIPMENT_SLOT_OFFHAND)
+    {
+        switch (proto->InventoryType)
+        {
+            case INVTYPE_WEAPON:
+                if (proto->SubClass == ITEM_SUBCLASS_WEAPON_POLEARM)
+                    return false;
+                [[fallthrough]];
+            case INVTYPE_WEAPONOFFHAND:
+                if (!capabilities.canDualWield)
+                    return false;
+                break;
+            case INVTYPE_2HWEAPON:
+                if (!capabilities.canDualWield || !capabilities.canTitanGrip)
+                    return false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+/* The real check behind the static one, for VerifyStaticEquip. Only a static
+ * "no" that the core would have accepted is worth shouting about; the other
+ * direction is expected and just costs one more allocation later.
+ */
+
+bool CouldEquipItemVerified(Player* bot, BotEquipCapabilities const& capabilities, uint8 slot, ItemTemplate const* proto)
+{
+    bool const allowed = CouldEquipItem(capabilities, slot, proto);
+    if (allowed || !proto || !GetModuleConfig()->verifyStaticEquip)
+        return allowed;
+
+    uint16 dest = 0;
+    if (CanEquipUnseenItemForModule(bot, slot, dest, proto->ItemId))
+    {
+        LOG_ERROR("module", "mod-playerbot-bettersetup: static equip check rejected item {} for {} slot {} but the core accepts it.",
+                  proto->ItemId, bot->GetName(), slot);
+        return true;
+    }
+
+    return false;
+}
+
+struct RankedGearCandidate
+{
+    float score = 0.0f;
+    uint32 itemId = 0;
+};
+
+/* Highest score wins and, among equal scores, the first one found, which is
+ * exactly what the old inline "score > bestScore" loops picked. With
+ * enforceTwinSlotRule, a ring or trinket that would pair up with whatever is
+ * in the other slot right now is passed over too.
+ */
+
+uint32 PickEquippableGearCandidate(Player* bot, uint8 slot, std::vector<RankedGearCandidate>& ranked, uint16& dest,
+                                   bool enforceTwinSlotRule = false)
+{
+    std::stable_sort(ranked.begin(), ranked.end(), [](RankedGearCandidate const& left, RankedGearCandidate const& right)
+    {
+        return left.score > right.score;
+    });
+
+    for (RankedGearCandidate const& candidate : ranked)
+    {
+        if (candidate.score <= -1.0f)
+            break;
+
+        if (enforceTwinSlotRule && ViolatesSpecPlayerTwinSlotRule(bot, slot, sObjectMgr->GetItemTemplate(candidate.itemId)))
+            continue;
+
+        if (CanEquipUnseenItemForModule(bot, slot, dest, candidate.itemId))
+            return candidate.itemId;
+    }
+
+    dest = 0;
+    return 0;
+}
+
+/* Shared item score cache.
+ * The same item used to be scored again on every retry, for both rings and
+ * both trinkets, and for every bot of the same build in a group fanout.
+ * StatsWeightCalculator weights depend on class, spec tab, role, level, the
+ * dual-wield / titan-grip penalties and, through its talent-aura checks, the
+ * talents themselves, so that is the profile the cache is keyed on: the
+ * build bits plus the talent signature the spec detector already computes.
+ * Overflow penalties and set bonuses read the gear the bot is
+ * wearing right now, which would make the score a property of the moment
+ * rather than of the build; like the upstream factory gear pass, these
+ * passes score without them. Weights only move with playerbots config, so
+ * the cache is dropped on config reload and when it reaches its size cap.
+ */
+
+struct ItemScoreKey
+{
+    uint64 profileKey = 0;
+    uint32 itemId = 0;
+
+    bool operator==(ItemScoreKey const& other) const
+    {
+        return profileKey == other.profileKey && itemId == other.itemId;
+    }
+};
+
+struct ItemScoreKeyHash
+{
+    size_t operator()(ItemScoreKey const& key) const
+    {
+        return std::hash<uint64>()(key.profileKey ^ (static_cast<uint64>(key.itemId) * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+std::unordered_map<ItemScoreKey, float, ItemScoreKeyHash>& GetItemScoreCache()
+{
+    static std::unordered_map<ItemScoreKey, float, ItemScoreKeyHash> scores;
+    return scores;
+}
+
+void ClearItemScoreCache()
+{
+    GetItemScoreCache().clear();
+}
+
+struct GearScorer
+{
+    explicit GearScorer(Player* bot)
+        : calculator(bot)
+    {
+        calculator.SetOverflowPenalty(false);
+        calculator.SetItemSetBonus(false);
+
+        uint32 const tab = AiFactory::GetPlayerSpecTab(bot);
+        uint32 const profile = (bot->GetLevel() << 16) | (bot->getClass() << 8) | (tab << 4) |
+                               (PlayerbotAI::IsTank(bot) ? 8u : 0u) | (PlayerbotAI::IsHeal(bot) ? 4u : 0u) |
+                               (bot->CanDualWield() ? 2u : 0u) | (bot->CanTitanGrip() ? 1u : 0u);
+        profileKey = (ComputeTalentSignature(bot) ^ profile) * 1099511628211ULL;
+    }
+
+    float Score(uint32 itemId)
+    {
+        uint32 const capacity = GetModuleConfig()->gearScoreCacheEntries;
+        if (!capacity)
+            return calculator.CalculateItem(itemId);
+
+        std::unordered_map<ItemScoreKey, float, ItemScoreKeyHash>& scores = GetItemScoreCache();
+        ItemScoreKey const key{ profileKey, itemId };
+        auto const found = scores.find(key);
+        if (found != scores.end())
+            return found->second;
+
+        if (scores.size() >= capacity)
+            scores.clear();
+
+        float const score = calculator.CalculateItem(itemId);
+        scores.emplace(key, score);
+        return score;
+    }
+
+    StatsWeightCalculator calculator;
+    uint64 profileKey = 0;
+};
+
+bool EquipPreferredArmorForSlot(Player* bot, GearScorer& scorer, uint8 slot, uint32 preferredSubClass,
+                                uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl,
+                                ModuleConfig const* config, bool applySpecPlayerRestrictions = false, uint8 levelSearchWindow = 10)
+{
+    std::vector<InventoryType> const inventoryTypes = GetArmorInventoryTypesForSlot(slot);
+    if (inventoryTypes.empty())
+        return false;
+
+    int32 const level = static_cast<int32>(bot->GetLevel());
+    int32 const minLevel = std::max(level - std::min(level, static_cast<int32>(levelSearchWindow)), 1);
+
+    BotEquipCapabilities const capabilities = BuildBotEquipCapabilities(bot);
+    std::vector<RankedGearCandidate> ranked;
+
+    /* Without a config there is no band, and also no quality floor. */
+
+    GearCandidateQuery query = BuildGearCandidateQuery(config ? ITEM_QUALITY_UNCOMMON : ITEM_QUALITY_POOR, qualityLimit,
+                                                       targetAverageIlvl, config);
+    query.armorOnly = true;
+    query.anySubClass = false;
+    query.subClass = preferredSubClass;
+    std::vector<GearCandidate const*> candidates;
+
+    for (int32 requiredLevel = level; requiredLevel >= minLevel; --requiredLevel)
+    {
+        for (InventoryType inventoryType : inventoryTypes)
+        {
+            CollectGearCandidates(GetGearCandidateBucket(requiredLevel, inventoryType), query, candidates);
+
+            for (GearCandidate const* candidate : candidates)
+            {
+                uint32 const itemId = candidate->itemId;
+                if (!PassesExpansionLimitFilter(bot, itemId))
+                    continue;
+
+                ItemTemplate const* proto = sObjectMgr->GetItemTemplate(itemId);
+                if (!proto)
+                    continue;
+
+                if (proto->Class != ITEM_CLASS_ARMOR || proto->SubClass != preferredSubClass)
+                    continue;
+
+                if (!IsTierArmorSubClass(proto->SubClass))
+                    continue;
+
+                if (proto->Quality > qualityLimit)
+                    continue;
+
+                if (proto->RequiredLevel > bot->GetLevel() || proto->Duration != 0 || proto->Bonding == BIND_QUEST_ITEM)
+                    continue;
+
+                if (config && !IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, *config, applySpecPlayerRestrictions))
+                    continue;
+
+                if (!CouldEquipItemVerified(bot, capabilities, slot, proto))
+                    continue;
+
+                ranked.push_back({ scorer.Score(itemId), itemId });
+            }
+        }
+    }
+
+    uint16 bestDest = 0;
+    uint32 const bestItemId = PickEquippableGearCandidate(bot, slot, ranked, bestDest);
+    if (bestItemId == 0)
+        return false;
+
+    if (Item* oldItem = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+        bot->DestroyItem(INVENTORY_SLOT_BAG_0, slot, true);
+
+    if (bot->EquipNewItem(bestDest, bestItemId, true))
         bot->AutoUnequipOffhandIfNeed();
+
+    return true;
 }
 
 /* Enforce strict armor tier preference for core armor slots.
  * Priority is highest wearable tier: plate > mail > leather > cloth.
  */
 
-void EnforcePreferredArmorTier(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit)
+uint32 EnforcePreferredArmorTier(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit)
 {
     if (!bot)
-        return;
+        return 0;
 
     uint32 const preferredSubClass = GetPreferredArmorSubClass(bot);
-    StatsWeightCalculator calculator(bot);
+    GearScorer scorer(bot);
+    uint32 changedSlots = 0;
 
     for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
     {
@@ -3102,6 +4694,7 @@ void EnforcePreferredArmorTier(Player* bot, uint32 gearScoreLimit, uint32 qualit
                 proto->SubClass != preferredSubClass)
             {
                 bot->DestroyItem(INVENTORY_SLOT_BAG_0, slot, true);
+                changedSlots |= 1u << slot;
                 needsPreferred = true;
             }
         }
@@ -3110,21 +4703,49 @@ void EnforcePreferredArmorTier(Player* bot, uint32 gearScoreLimit, uint32 qualit
             needsPreferred = true;
         }
 
-        if (needsPreferred)
-            EquipPreferredArmorForSlot(bot, calculator, slot, preferredSubClass, gearScoreLimit, qualityLimit, 0.0f, nullptr);
+        if (needsPreferred &&
+            EquipPreferredArmorForSlot(bot, scorer, slot, preferredSubClass, gearScoreLimit, qualityLimit, 0.0f, nullptr))
+        {
+            changedSlots |= 1u << slot;
+        }
     }
+
+    return changedSlots;
 }
 
-void EnforceTargetItemLevelBand(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl,
-                                ModuleConfig const& config, bool applySpecPlayerRestrictions = false, uint8 levelSearchWindow = 10)
+/* Target-band gear planner, in two halves.
+ * BuildTargetBandGearPlan decides, without touching the bot, which slots
+ * need a different item: per slot it ranks every in-band candidate under
+ * the quality cap and on the right armor tier, and marks the slot unchanged
+ * when the worn item is in band, on tier and scores at least as well as the
+ * top of that ranking. ApplyTargetBandGearPlan then visits only the changed
+ * slots, in planner order, with the core's real equip check. Re-running it
+ * on a bot that already matches the plan destroys and creates nothing.
+ */
+
+struct GearPlanSlot
 {
-    if (!bot || targetAverageIlvl <= 0.0f)
-        return;
+    uint8 slot = NULL_SLOT;
+    bool wornInBand = false;
+    std::vector<RankedGearCandidate> ranked;
+};
 
-    PlayerbotFactory factory(bot, bot->GetLevel(), qualityLimit, gearScoreLimit);
-    StatsWeightCalculator calculator(bot);
-    uint32 const preferredArmorSubClass = GetPreferredArmorSubClass(bot);
-    std::vector<uint8> const initSlotsOrder = {
+struct GearPlan
+{
+    std::vector<GearPlanSlot> changes;
+    uint32 missingSlots = 0;
+    bool needsFactory = false;
+};
+
+struct GearPlanResult
+{
+    uint32 changedSlots = 0;
+    uint32 missingSlots = 0;
+};
+
+std::array<uint8, 17> const& GetBandPlannerSlots()
+{
+    static std::array<uint8, 17> const slots = {
         EQUIPMENT_SLOT_TRINKET1, EQUIPMENT_SLOT_TRINKET2, EQUIPMENT_SLOT_MAINHAND, EQUIPMENT_SLOT_OFFHAND,
         EQUIPMENT_SLOT_RANGED, EQUIPMENT_SLOT_HEAD, EQUIPMENT_SLOT_SHOULDERS, EQUIPMENT_SLOT_CHEST,
         EQUIPMENT_SLOT_LEGS, EQUIPMENT_SLOT_HANDS, EQUIPMENT_SLOT_NECK, EQUIPMENT_SLOT_WAIST,
@@ -3132,32 +4753,93 @@ void EnforceTargetItemLevelBand(Player* bot, uint32 gearScoreLimit, uint32 quali
         EQUIPMENT_SLOT_BACK
     };
 
+    return slots;
+}
+
+bool IsWornItemKeptByPlan(Player* bot, uint8 slot, ItemTemplate const* proto, uint32 preferredArmorSubClass,
+                          float targetAverageIlvl, ModuleConfig const& config, bool applySpecPlayerRestrictions)
+{
+    if (!proto || !IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, config, applySpecPlayerRestrictions))
+        return false;
+
+    return !IsPrimaryArmorSlot(slot) || proto->Class != ITEM_CLASS_ARMOR || !IsTierArmorSubClass(proto->SubClass) ||
+           proto->SubClass == preferredArmorSubClass;
+}
+
+/* Gear-plan cache.
+ * Bots of the same build, level and target bucket rank the same candidates
+ * in the same order, so that ranking is computed once and shared. The
+ * shared part is deliberately wider than any one bot needs: it covers the
+ * whole ilvl bucket and skips every check that depends on the bot itself.
+ * Each bot then filters it with the exact band, the twin-slot and quest
+ * rules, and its own static equip check. Filtering a stable ranking keeps
+ * its order, so a bot gets the same plan it would have built alone.
+ */
+
+using GearPlanKey = std::tuple<uint64, uint32, uint32, uint32, bool, uint8, bool>;
+using GearPlanRanking = std::array<std::vector<RankedGearCandidate>, 17>;
+
+struct GearPlanCache
+{
+    std::list<std::pair<GearPlanKey, std::shared_ptr<GearPlanRanking const>>> entries;
+    std::map<GearPlanKey, decltype(entries)::iterator> index;
+};
+
+GearPlanCache& GetGearPlanCache()
+{
+    static GearPlanCache cache;
+    return cache;
+}
+
+void ClearGearPlanCache()
+{
+    GearPlanCache& cache = GetGearPlanCache();
+    cache.index.clear();
+    cache.entries.clear();
+}
+
+std::shared_ptr<GearPlanRanking const> BuildGearPlanRanking(Player* bot, GearScorer& scorer, uint32 qualityLimit, uint32 targetBucket,
+                                                            ModuleConfig const& config, uint8 levelSearchWindow)
+{
+    auto ranking = std::make_shared<GearPlanRanking>();
+
+    uint32 const preferredArmorSubClass = GetPreferredArmorSubClass(bot);
     int32 const level = static_cast<int32>(bot->GetLevel());
     int32 const minLevel = std::max(level - std::min(level, static_cast<int32>(levelSearchWindow)), 1);
+    std::array<uint8, 17> const& slots = GetBandPlannerSlots();
+    std::vector<GearCandidate const*> candidates;
+
+    /* Every target that rounds to this bucket has its band inside these bounds. */
+
+    GearCandidateQuery baseQuery = BuildGearCandidateQuery(ITEM_QUALITY_UNCOMMON, qualityLimit, 0.0f, nullptr);
+    baseQuery.bounded = true;
+    baseQuery.lowerIlvl = std::max(1.0f, (static_cast<float>(targetBucket) - 0.5f) * config.gearValidationLowerRatio);
+    baseQuery.upperIlvl = (static_cast<float>(targetBucket) + 0.5f) * config.gearValidationUpperRatio;
 
-    for (uint8 slot : initSlotsOrder)
+    for (size_t slotIndex = 0; slotIndex < slots.size(); ++slotIndex)
     {
-        Item* equipped = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
-        if (equipped)
+        uint8 const slot = slots[slotIndex];
+        std::vector<RankedGearCandidate>& ranked = (*ranking)[slotIndex];
+
+        GearCandidateQuery query = baseQuery;
+        if (IsPrimaryArmorSlot(slot))
         {
-            ItemTemplate const* equippedProto = equipped->GetTemplate();
-            if (equippedProto &&
-                IsValidTargetBandGearItem(bot, slot, equippedProto, targetAverageIlvl, config, applySpecPlayerRestrictions))
-            {
-                continue;
-            }
+            query.armorOnly = true;
+            query.anySubClass = false;
+            query.subClass = preferredArmorSubClass;
         }
 
-        float bestScore = -1.0f;
-        uint32 bestItemId = 0;
-        uint16 bestDest = 0;
+        std::vector<InventoryType> const inventoryTypes = GetInventoryTypesForSlot(slot);
 
         for (int32 requiredLevel = level; requiredLevel >= minLevel; --requiredLevel)
         {
-            for (InventoryType inventoryType : GetInventoryTypesForSlot(slot))
+            for (InventoryType inventoryType : inventoryTypes)
             {
-                for (uint32 itemId : sRandomItemMgr.GetCachedEquipments(requiredLevel, inventoryType))
+                CollectGearCandidates(GetGearCandidateBucket(requiredLevel, inventoryType), query, candidates);
+
+                for (GearCandidate const* candidate : candidates)
                 {
+                    uint32 const itemId = candidate->itemId;
                     if (!PassesExpansionLimitFilter(bot, itemId))
                         continue;
 
@@ -3171,9 +4853,6 @@ void EnforceTargetItemLevelBand(Player* bot, uint32 gearScoreLimit, uint32 quali
                     if (proto->Quality <= ITEM_QUALITY_NORMAL || proto->Quality > qualityLimit)
                         continue;
 
-                    if (!IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, config, applySpecPlayerRestrictions))
-                        continue;
-
                     if (proto->RequiredLevel > bot->GetLevel() || proto->Duration != 0 || proto->Bonding == BIND_QUEST_ITEM)
                         continue;
 
@@ -3181,41 +4860,175 @@ void EnforceTargetItemLevelBand(Player* bot, uint32 gearScoreLimit, uint32 quali
                         proto->Class != ITEM_CLASS_WEAPON)
                         continue;
 
-                    if (IsPrimaryArmorSlot(slot))
-                    {
-                        if (proto->Class != ITEM_CLASS_ARMOR || !IsTierArmorSubClass(proto->SubClass) ||
-                            proto->SubClass != preferredArmorSubClass)
-                        {
-                            continue;
-                        }
-                    }
+                    if (IsPrimaryArmorSlot(slot))
+                    {
+                        if (proto->Class != ITEM_CLASS_ARMOR || !IsTierArmorSubClass(proto->SubClass) ||
+                            proto->SubClass != preferredArmorSubClass)
+                        {
+                            continue;
+                        }
+                    }
+
+                    ranked.push_back({ scorer.Score(itemId), itemId });
+                }
+            }
+        }
+
+        std::stable_sort(ranked.begin(), ranked.end(), [](RankedGearCandidate const& left, RankedGearCandidate const& right)
+        {
+            return left.score > right.score;
+        });
+    }
+
+    return ranking;
+}
+
+std::shared_ptr<GearPlanRanking const> GetGearPlanRanking(Player* bot, GearScorer& scorer, uint32 qualityLimit, float targetAverageIlvl,
+                                                          ModuleConfig const& config, bool applySpecPlayerRestrictions,
+                                                          uint8 levelSearchWindow)
+{
+    uint32 const targetBucket = static_cast<uint32>(std::lround(targetAverageIlvl));
+    uint32 const capacity = config.gearPlanCacheEntries;
+    if (!capacity)
+        return BuildGearPlanRanking(bot, scorer, qualityLimit, targetBucket, config, levelSearchWindow);
+
+    GearPlanKey const key(scorer.profileKey, GetPreferredArmorSubClass(bot), targetBucket, qualityLimit,
+                          applySpecPlayerRestrictions, levelSearchWindow, sPlayerbotAIConfig.limitGearExpansion);
+
+    GearPlanCache& cache = GetGearPlanCache();
+    auto const found = cache.index.find(key);
+    if (found != cache.index.end())
+    {
+        cache.entries.splice(cache.entries.begin(), cache.entries, found->second);
+        return found->second->second;
+    }
+
+    std::shared_ptr<GearPlanRanking const> ranking =
+        BuildGearPlanRanking(bot, scorer, qualityLimit, targetBucket, config, levelSearchWindow);
+
+    cache.entries.emplace_front(key, ranking);
+    cache.index[key] = cache.entries.begin();
+
+    while (cache.entries.size() > capacity)
+    {
+        cache.index.erase(cache.entries.back().first);
+        cache.entries.pop_back();
+    }
+
+    return ranking;
+}
+
+GearPlan BuildTargetBandGearPlan(Player* bot, GearScorer& scorer, uint32 qualityLimit, float targetAverageIlvl,
+                                 ModuleConfig const& config, bool applySpecPlayerRestrictions, uint8 levelSearchWindow)
+{
+    GearPlan plan;
+
+    uint32 const preferredArmorSubClass = GetPreferredArmorSubClass(bot);
+    BotEquipCapabilities const capabilities = BuildBotEquipCapabilities(bot);
+    std::shared_ptr<GearPlanRanking const> const ranking =
+        GetGearPlanRanking(bot, scorer, qualityLimit, targetAverageIlvl, config, applySpecPlayerRestrictions, levelSearchWindow);
+    std::array<uint8, 17> const& slots = GetBandPlannerSlots();
+
+    for (size_t slotIndex = 0; slotIndex < slots.size(); ++slotIndex)
+    {
+        uint8 const slot = slots[slotIndex];
+        GearPlanSlot planned;
+        planned.slot = slot;
+
+        Item* equipped = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
+        planned.wornInBand = equipped && IsWornItemKeptByPlan(bot, slot, equipped->GetTemplate(), preferredArmorSubClass,
+                                                              targetAverageIlvl, config, applySpecPlayerRestrictions);
+
+        for (RankedGearCandidate const& candidate : (*ranking)[slotIndex])
+        {
+            ItemTemplate const* proto = sObjectMgr->GetItemTemplate(candidate.itemId);
+            if (!IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, config, applySpecPlayerRestrictions))
+                continue;
+
+            if (!CouldEquipItemVerified(bot, capabilities, slot, proto))
+                continue;
+
+            planned.ranked.push_back(candidate);
+        }
+
+        if (planned.ranked.empty())
+        {
+            if (!planned.wornInBand)
+            {
+                plan.missingSlots |= 1u << slot;
+
+                /* Nothing to plan and nothing worn: only the factory can dress this slot. */
+
+                if (!equipped && slot != EQUIPMENT_SLOT_OFFHAND)
+                    plan.needsFactory = true;
+            }
+
+            continue;
+        }
+
+        if (planned.wornInBand &&
+            (equipped->GetEntry() == planned.ranked.front().itemId ||
+             scorer.Score(equipped->GetEntry()) >= planned.ranked.front().score))
+        {
+            continue;
+        }
+
+        plan.changes.push_back(std::move(planned));
+    }
+
+    return plan;
+}
+
+GearPlanResult ApplyTargetBandGearPlan(Player* bot, GearScorer& scorer, GearPlan& plan, uint32 gearScoreLimit, uint32 qualityLimit,
+                                       float targetAverageIlvl, ModuleConfig const& config, bool applySpecPlayerRestrictions,
+                                       uint8 levelSearchWindow)
+{
+    GearPlanResult result;
+    result.missingSlots = plan.missingSlots;
+
+    /* The plan checked each ring and trinket against its partner as worn before
+     * the pass; when both slots change, the partner has to be looked at again
+     * once the first of them is on.
+     */
+
+    bool const enforceTwinSlotRule = applySpecPlayerRestrictions && config.specPlayerEnforceUniqueRingTrinketPairs;
 
-                    uint16 dest = 0;
-                    if (!CanEquipUnseenItemForModule(bot, slot, dest, itemId))
-                        continue;
+    for (GearPlanSlot& planned : plan.changes)
+    {
+        uint8 const slot = planned.slot;
+        Item* equipped = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
 
-                    float const score = calculator.CalculateItem(itemId);
-                    if (score > bestScore)
-                    {
-                        bestScore = score;
-                        bestItemId = itemId;
-                        bestDest = dest;
-                    }
-                }
-            }
+        uint16 bestDest = 0;
+        uint32 const bestItemId = PickEquippableGearCandidate(bot, slot, planned.ranked, bestDest, enforceTwinSlotRule);
+        if (bestItemId == 0)
+        {
+            /* An empty offhand behind a two-hander is the plan, not a gap. */
+
+            bool const blockedByTwoHand = slot == EQUIPMENT_SLOT_OFFHAND && !equipped && bot->IsTwoHandUsed();
+            if (!planned.wornInBand && !blockedByTwoHand)
+                result.missingSlots |= 1u << slot;
+
+            continue;
         }
 
-        if (bestItemId == 0)
+        if (planned.wornInBand && equipped &&
+            (equipped->GetEntry() == bestItemId || scorer.Score(equipped->GetEntry()) >= scorer.Score(bestItemId)))
+        {
             continue;
+        }
 
         if (equipped)
             bot->DestroyItem(INVENTORY_SLOT_BAG_0, slot, true);
 
         if (bot->EquipNewItem(bestDest, bestItemId, true))
             bot->AutoUnequipOffhandIfNeed();
+
+        result.changedSlots |= 1u << slot;
     }
 
-    EnforcePreferredArmorTier(bot, gearScoreLimit, qualityLimit);
+    result.changedSlots |= EnforcePreferredArmorTier(bot, gearScoreLimit, qualityLimit);
+
+    uint32 const preferredArmorSubClass = GetPreferredArmorSubClass(bot);
     for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
     {
         if (!IsPrimaryArmorSlot(slot))
@@ -3229,9 +5042,27 @@ void EnforceTargetItemLevelBand(Player* bot, uint32 gearScoreLimit, uint32 quali
         if (!proto || IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, config, applySpecPlayerRestrictions))
             continue;
 
-        EquipPreferredArmorForSlot(bot, calculator, slot, preferredArmorSubClass, gearScoreLimit, qualityLimit,
-                                   targetAverageIlvl, &config, applySpecPlayerRestrictions, levelSearchWindow);
+        if (EquipPreferredArmorForSlot(bot, scorer, slot, preferredArmorSubClass, gearScoreLimit, qualityLimit,
+                                       targetAverageIlvl, &config, applySpecPlayerRestrictions, levelSearchWindow))
+        {
+            result.changedSlots |= 1u << slot;
+        }
+    }
+
+    /* The armor-tier fixup above can still land a slot in band. */
+
+    for (uint8 slot : GetBandPlannerSlots())
+    {
+        if (!(result.missingSlots & (1u << slot)))
+            continue;
+
+        Item* equipped = bot->GetItemByPos(INVENTORY_SLOT_BAG_0, slot);
+        ItemTemplate const* proto = equipped ? equipped->GetTemplate() : nullptr;
+        if (proto && IsValidTargetBandGearItem(bot, slot, proto, targetAverageIlvl, config, applySpecPlayerRestrictions))
+            result.missingSlots &= ~(1u << slot);
     }
+
+    return result;
 }
 
 /* Remove spare gear generated during rerolls from backpack/bags.
@@ -3300,20 +5131,111 @@ void RunGearPass(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit)
     bot->DurabilityRepairAll(false, 1.0f, false);
 }
 
-void RunGearPass(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl, ModuleConfig const& config)
+/* Target-band gearing: plan, diff, apply.
+ * The factory reroll (destroy everything, InitEquipment, enchant, clean bags)
+ * only runs when the plan has an empty slot it cannot fill. Otherwise only
+ * changed slots are touched, and ammo, enchants and bag cleanup follow only
+ * when something actually changed. Returns the slots left without an
+ * in-band item.
+ */
+
+uint32 RunGearPass(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl, ModuleConfig const& config,
+                   bool applySpecPlayerRestrictions = false, uint8 levelSearchWindow = 10)
 {
-    RunGearPass(bot, gearScoreLimit, qualityLimit);
-    EnforceTargetItemLevelBand(bot, gearScoreLimit, qualityLimit, targetAverageIlvl, config);
-    PlayerbotFactory(bot, bot->GetLevel(), qualityLimit, gearScoreLimit).InitAmmo();
+    if (targetAverageIlvl <= 0.0f)
+    {
+        DestroyOldGear(bot);
+        RunGearPass(bot, gearScoreLimit, qualityLimit);
+        return 0;
+    }
+
+    GearScorer scorer(bot);
+    GearPlan plan = BuildTargetBandGearPlan(bot, scorer, qualityLimit, targetAverageIlvl, config, applySpecPlayerRestrictions,
+                                            levelSearchWindow);
+
+    bool const rerolled = plan.needsFactory;
+    if (rerolled)
+    {
+        DestroyOldGear(bot);
+        RunGearPass(bot, gearScoreLimit, qualityLimit);
+        plan = BuildTargetBandGearPlan(bot, scorer, qualityLimit, targetAverageIlvl, config, applySpecPlayerRestrictions,
+                                       levelSearchWindow);
+    }
+
+    GearPlanResult const result = ApplyTargetBandGearPlan(bot, scorer, plan, gearScoreLimit, qualityLimit, targetAverageIlvl,
+                                                          config, applySpecPlayerRestrictions, levelSearchWindow);
+
+    if (result.changedSlots)
+    {
+        PlayerbotFactory factory(bot, bot->GetLevel(), qualityLimit, gearScoreLimit);
+        if (result.changedSlots & (1u << EQUIPMENT_SLOT_RANGED))
+            DestroyOldGear(bot);
+
+        factory.InitAmmo();
+
+        if (bot->GetLevel() >= sPlayerbotAIConfig.minEnchantingBotLevel)
+            factory.ApplyEnchantAndGemsNew();
+
+        CleanupBagGear(bot);
+    }
+    else if (rerolled)
+    {
+        PlayerbotFactory(bot, bot->GetLevel(), qualityLimit, gearScoreLimit).InitAmmo();
+    }
+
+    bot->DurabilityRepairAll(false, 1.0f, false);
+    return result.missingSlots;
 }
 
-void RunGearPass(Player* bot, uint32 gearScoreLimit, uint32 qualityLimit, float targetAverageIlvl, ModuleConfig const& config,
-                 bool applySpecPlayerRestrictions, uint8 levelSearchWindow)
+char const* GetEquipmentSlotLabel(uint8 slot)
+{
+    switch (slot)
+    {
+        case EQUIPMENT_SLOT_HEAD: return "head";
+        case EQUIPMENT_SLOT_NECK: return "neck";
+        case EQUIPMENT_SLOT_SHOULDERS: return "shoulders";
+        case EQUIPMENT_SLOT_CHEST: return "chest";
+        case EQUIPMENT_SLOT_WAIST: return "waist";
+        case EQUIPMENT_SLOT_LEGS: return "legs";
+        case EQUIPMENT_SLOT_FEET: return "feet";
+        case EQUIPMENT_SLOT_WRISTS: return "wrists";
+        case EQUIPMENT_SLOT_HANDS: return "hands";
+        case EQUIPMENT_SLOT_FINGER1: return "finger1";
+        case EQUIPMENT_SLOT_FINGER2: return "finger2";
+        case EQUIPMENT_SLOT_TRINKET1: return "trinket1";
+        case EQUIPMENT_SLOT_TRINKET2: return "trinket2";
+        case EQUIPMENT_SLOT_BACK: return "back";
+        case EQUIPMENT_SLOT_MAINHAND: return "mainhand";
+        case EQUIPMENT_SLOT_OFFHAND: return "offhand";
+        case EQUIPMENT_SLOT_RANGED: return "ranged";
+        default: return "other";
+    }
+}
+
+/* Say which slots the band planner could not fill, once, instead of quietly
+ * rerolling the whole set in the hope that it works out next time.
+ */
+
+void ReportMissingBandSlots(Player* bot, uint32 missingSlots, float targetAverageIlvl)
 {
-    RunGearPass(bot, gearScoreLimit, qualityLimit);
-    EnforceTargetItemLevelBand(bot, gearScoreLimit, qualityLimit, targetAverageIlvl, config, applySpecPlayerRestrictions,
-                               levelSearchWindow);
-    PlayerbotFactory(bot, bot->GetLevel(), qualityLimit, gearScoreLimit).InitAmmo();
+    if (!bot || !missingSlots)
+        return;
+
+    std::string slots;
+    for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+    {
+        if (!(missingSlots & (1u << slot)))
+            continue;
+
+        if (!slots.empty())
+            slots += ", ";
+
+        slots += GetEquipmentSlotLabel(slot);
+    }
+
+    if (PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot))
+        botAI->TellMasterNoFacing("gear: no in-band item near ilvl " + std::to_string(static_cast<uint32>(targetAverageIlvl)) +
+                                  " for " + slots + " on " + bot->GetName() + '.');
 }
 
 /* Build a readable target-ilvl label from mode/ratio policy.
@@ -3356,21 +5278,16 @@ void ApplyAutoGear(Player* bot, Player* commandSender, ModuleConfig const& confi
 
         if (targetAverageIlvl > 0.0f && gearScoreLimit != 0)
         {
-            for (uint8 attempt = 0; attempt < config.gearRetryCount; ++attempt)
-            {
-                DestroyOldGear(bot);
-                RunGearPass(bot, gearScoreLimit, config.gearQualityCapRatioMode, targetAverageIlvl, config);
-
-                if (IsGearWithinTargetBand(bot, targetAverageIlvl, config))
-                    break;
-            }
-
+            NoteGearAttempt();
+            uint32 const missingSlots = RunGearPass(bot, gearScoreLimit, config.gearQualityCapRatioMode, targetAverageIlvl, config);
+            ReportMissingBandSlots(bot, missingSlots, targetAverageIlvl);
             return;
         }
     }
 
     /* Top-for-level fallback path for invalid ratio context or explicit top_for_level mode. */
 
+    NoteGearAttempt();
     DestroyOldGear(bot);
     RunGearPass(bot, 0, config.gearQualityCapTopForLevel);
 }
@@ -3424,18 +5341,90 @@ void RunSpecPlayerPostSpecMaintenance(Player* bot, ExpansionCap cap, ModuleConfi
         factory.InitPetTalents();
 }
 
-bool IsTalentLockedQuestReward(Player* bot, Quest const* quest)
+/* Bumped whenever something the spell pass reads from is replaced, so a bot's
+ * spell watermark from before that point no longer counts. A class's first
+ * build replaces nothing, and no bot of that class can hold a watermark
+ * against it, so it leaves other classes' watermarks alone.
+ */
+
+uint32& GetSpellManifestVersion()
 {
-    if (!bot || !quest)
-        return false;
+    static uint32 version = 1;
+    return version;
+}
+
+void BumpSpellManifestVersion()
+{
+    ++GetSpellManifestVersion();
+}
+
+/* Shared refresh for the per-class spell indexes below.
+ * An index that is built and still matches the live data is used as is.
+ * Otherwise it is rebuilt from the live data and used without a second
+ * check, so a pass never loops on data that keeps moving.
+ */
+
+template <typename Index, typename Build, typename IsCurrent>
+Index const& RefreshSpellIndex(Index& index, Build const& build, IsCurrent const& isCurrent)
+{
+    if (index.built && isCurrent(index))
+        return index;
+
+    bool const replacing = index.built;
+    build(index);
+    index.built = true;
+
+    if (replacing)
+        BumpSpellManifestVersion();
+
+    return index;
+}
+
+/* Per-class index of quests whose rewards teach class spells.
+ * Only class-restricted, non-repeatable quests from level 10 up ever qualify,
+ * and whether one rewards a blocked epic class mount depends on nothing but
+ * the class. That part is settled once per class, along with the reward
+ * spells that hang off a talent, and the result is sorted by min level.
+ * The spell pass walks the handful of entries up to the bot's level and only
+ * checks race, skill and the talent prerequisites against the bot itself.
+ * Before each pass the index is checked against the live templates (the
+ * template count moved, or an entry's template object, min level or class
+ * mask no longer matches) and rebuilt from them after a quest reload.
+ */
+
+struct QuestClassSpellEntry
+{
+    uint32 questId = 0;
+    Quest const* quest = nullptr;
+    uint32 minLevel = 0;
+    std::array<uint32, MAX_SPELL_EFFECTS> talentSpells = {};
+    uint8 talentSpellCount = 0;
+};
+
+struct QuestClassSpellIndex
+{
+    bool built = false;
+    size_t questTemplateCount = 0;
+    std::vector<QuestClassSpellEntry> entries;
+};
+
+std::array<QuestClassSpellIndex, MAX_CLASSES>& GetQuestClassSpellIndexes()
+{
+    static std::array<QuestClassSpellIndex, MAX_CLASSES> indexes;
+    return indexes;
+}
 
+/* Reward spells that need a talent first; the bot must already know them. */
+
+void CollectTalentLockedRewardSpells(Quest const* quest, QuestClassSpellEntry& entry)
+{
     int32 const spellId = quest->GetRewSpellCast();
-    if (!spellId)
-        return false;
+    if (spellId <= 0)
+        return;
 
     SpellInfo const* rewardSpell = sSpellMgr->GetSpellInfo(spellId);
     if (!rewardSpell)
-        return false;
+        return;
 
     for (uint8 i = 0; i < MAX_SPELL_EFFECTS; ++i)
     {
@@ -3446,8 +5435,81 @@ bool IsTalentLockedQuestReward(Player* bot, Quest const* quest)
         if (!firstRank)
             firstRank = rewardSpell->Effects[i].TriggerSpell;
 
-        bool const talentDependent = GetTalentSpellCost(firstRank) > 0 || sSpellMgr->IsAdditionalTalentSpell(firstRank);
-        if (talentDependent && !bot->HasSpell(rewardSpell->Effects[i].TriggerSpell))
+        if (GetTalentSpellCost(firstRank) > 0 || sSpellMgr->IsAdditionalTalentSpell(firstRank))
+            entry.talentSpells[entry.talentSpellCount++] = rewardSpell->Effects[i].TriggerSpell;
+    }
+}
+
+void BuildQuestClassSpellIndex(uint8 classId, QuestClassSpellIndex& index)
+{
+    ObjectMgr::QuestMap const& questTemplates = sObjectMgr->GetQuestTemplates();
+    index.questTemplateCount = questTemplates.size();
+    index.entries.clear();
+
+    uint32 const classMask = 1 << (classId - 1);
+
+    for (ObjectMgr::QuestMap::const_iterator itr = questTemplates.begin(); itr != questTemplates.end(); ++itr)
+    {
+        Quest const* quest = itr->second;
+        if (!quest || !quest->GetRequiredClasses() || (quest->GetRequiredClasses() & classMask) == 0)
+            continue;
+
+        if (quest->IsRepeatable() || quest->GetMinLevel() < 10)
+            continue;
+
+        int32 const rewardCastSpell = quest->GetRewSpellCast();
+        if (rewardCastSpell > 0 && SpellTeachesBlockedEpicClassMountSpellForClass(classId, static_cast<uint32>(rewardCastSpell)))
+            continue;
+
+        if (quest->GetRewSpell() && SpellTeachesBlockedEpicClassMountSpellForClass(classId, quest->GetRewSpell()))
+            continue;
+
+        QuestClassSpellEntry entry;
+        entry.questId = quest->GetQuestId();
+        entry.quest = quest;
+        entry.minLevel = quest->GetMinLevel();
+        CollectTalentLockedRewardSpells(quest, entry);
+        index.entries.push_back(entry);
+    }
+
+    std::stable_sort(index.entries.begin(), index.entries.end(),
+                     [](QuestClassSpellEntry const& left, QuestClassSpellEntry const& right)
+                     {
+                         return left.minLevel < right.minLevel;
+                     });
+}
+
+QuestClassSpellIndex const* GetQuestClassSpellIndex(uint8 classId)
+{
+    if (classId == 0 || classId >= MAX_CLASSES)
+        return nullptr;
+
+    uint32 const classMask = 1 << (classId - 1);
+    auto const isCurrent = [classMask](QuestClassSpellIndex const& index)
+    {
+        if (index.questTemplateCount != sObjectMgr->GetQuestTemplates().size())
+            return false;
+
+        for (QuestClassSpellEntry const& entry : index.entries)
+        {
+            Quest const* quest = sObjectMgr->GetQuestTemplate(entry.questId);
+            if (!quest || quest != entry.quest || quest->GetMinLevel() != entry.minLevel ||
+                (quest->GetRequiredClasses() & classMask) == 0)
+                return false;
+        }
+
+        return true;
+    };
+
+    return &RefreshSpellIndex(GetQuestClassSpellIndexes()[classId],
+                              [classId](QuestClassSpellIndex& index) { BuildQuestClassSpellIndex(classId, index); }, isCurrent);
+}
+
+bool IsTalentLockedQuestReward(Player* bot, QuestClassSpellEntry const& entry)
+{
+    for (uint8 i = 0; i < entry.talentSpellCount; ++i)
+    {
+        if (!bot->HasSpell(entry.talentSpells[i]))
             return true;
     }
 
@@ -3461,23 +5523,21 @@ void LearnQuestClassSpells(Player* bot)
     if (!bot)
         return;
 
-    ObjectMgr::QuestMap const& questTemplates = sObjectMgr->GetQuestTemplates();
-    for (ObjectMgr::QuestMap::const_iterator itr = questTemplates.begin(); itr != questTemplates.end(); ++itr)
+    QuestClassSpellIndex const* index = GetQuestClassSpellIndex(bot->getClass());
+    if (!index)
+        return;
+
+    for (QuestClassSpellEntry const& entry : index->entries)
     {
-        Quest const* quest = itr->second;
-        if (!quest || !quest->GetRequiredClasses())
-            continue;
+        if (entry.minLevel > bot->GetLevel())
+            break;
 
-        if (quest->IsRepeatable() || quest->GetMinLevel() < 10 || quest->GetMinLevel() > bot->GetLevel())
-            continue;
+        Quest const* quest = entry.quest;
 
         if (!bot->SatisfyQuestClass(quest, false) || !bot->SatisfyQuestRace(quest, false) || !bot->SatisfyQuestSkill(quest, false))
             continue;
 
-        if (IsTalentLockedQuestReward(bot, quest))
-            continue;
-
-        if (QuestRewardsBlockedEpicClassMountSpell(bot, quest))
+        if (IsTalentLockedQuestReward(bot, entry))
             continue;
 
         bot->learnQuestRewardedSpells(quest);
@@ -3532,55 +5592,272 @@ uint32 ResolveTrainerSpellSkillLine(Trainer::Trainer* trainer, Trainer::Spell co
     return trainer ? GetProfessionSkillLineFromSpell(trainer->GetTrainerRequirement()) : 0;
 }
 
-bool ShouldTeachTrainerSpell(Player* bot, Trainer::Trainer* trainer, Trainer::Spell const* trainerSpell,
-                             bool allowPrimaryProfessionSpells)
+/* Quieter spell learning for a whole command.
+ * Player::learnSpell sends SMSG_LEARNED_SPELL for every spell, and a fresh
+ * level-80 bot can pick up hundreds in one setup. While a batch is open for a
+ * bot, the trainer and profession passes replay learnSpell step by step:
+ * addSpell, the OnPlayerLearnSpell script hook, then re-learning an inactive
+ * next rank and inactive spells that require this one. Only the
+ * SMSG_LEARNED_SPELL is held back; addSpell itself still sends
+ * SMSG_SUPERCEDED_SPELL when a rank replaces another. The batch sends one
+ * SMSG_INITIAL_SPELLS when the command is done. Anything learned outside
+ * those passes still goes through the core as before.
+ * Off unless Spec.QuietSpellLearn is set: a disabled batch never opens, so
+ * every spell takes the plain learnSpell path.
+ */
+
+class SilentSpellLearnBatch
 {
-    if (!bot || !trainer || !trainerSpell || !trainer->CanTeachSpell(bot, trainerSpell))
-        return false;
+public:
+    SilentSpellLearnBatch(Player* bot, bool enabled)
+        : bot(bot), previous(currentBatch), active(enabled)
+    {
+        if (active)
+            currentBatch = this;
+    }
 
-    if (SpellTeachesBlockedEpicClassMountSpell(bot, trainerSpell->SpellId))
-        return false;
+    ~SilentSpellLearnBatch()
+    {
+        if (!active)
+            return;
 
-    if (trainer->GetTrainerType() == Trainer::Type::Class)
-        return true;
+        currentBatch = previous;
 
-    if (trainer->GetTrainerType() != Trainer::Type::Tradeskill)
-        return false;
+        if (learnedCount && bot && bot->IsInWorld())
+            bot->SendInitialSpells();
+    }
 
-    uint32 const skillLine = ResolveTrainerSpellSkillLine(trainer, trainerSpell);
-    if (IsSecondaryProfessionSkillId(skillLine))
-        return true;
+    SilentSpellLearnBatch(SilentSpellLearnBatch const&) = delete;
+    SilentSpellLearnBatch& operator=(SilentSpellLearnBatch const&) = delete;
+
+    static void Learn(Player* bot, uint32 spellId)
+    {
+        if (!currentBatch || currentBatch->bot != bot)
+        {
+            bot->learnSpell(spellId, false);
+            return;
+        }
+
+        currentBatch->LearnQuietly(spellId);
+    }
+
+private:
+    bool HasInactiveSpell(uint32 spellId) const
+    {
+        PlayerSpellMap const& spells = bot->GetSpellMap();
+        auto const itr = spells.find(spellId);
+        return itr != spells.end() && itr->second->State != PLAYERSPELL_REMOVED && !itr->second->Active;
+    }
+
+    void LearnQuietly(uint32 spellId)
+    {
+        if (bot->HasActiveSpell(spellId))
+            return;
+
+        uint32 firstRankSpellId = sSpellMgr->GetFirstSpellInChain(spellId);
+        if (!firstRankSpellId)
+            firstRankSpellId = spellId;
+
+        bool const talentSpell = GetTalentSpellCost(firstRankSpellId) > 0 || sSpellMgr->IsAdditionalTalentSpell(firstRankSpellId);
+        if (bot->addSpell(spellId, talentSpell ? bot->GetActiveSpecMask() : SPEC_MASK_ALL, true))
+        {
+            sScriptMgr->OnPlayerLearnSpell(bot, spellId);
+            ++learnedCount;
+        }
 
-    return allowPrimaryProfessionSpells && IsPrimaryProfessionSkillId(skillLine);
+        /* Same order as the core: next ranks before the spells that require them. */
+
+        if (uint32 const nextSpellId = sSpellMgr->GetNextSpellInChain(spellId))
+        {
+            if (HasInactiveSpell(nextSpellId))
+                LearnQuietly(nextSpellId);
+        }
+
+        SpellsRequiringSpellMapBounds const requiringBounds = sSpellMgr->GetSpellsRequiringSpellBounds(spellId);
+        for (auto itr = requiringBounds.first; itr != requiringBounds.second; ++itr)
+        {
+            if (HasInactiveSpell(itr->second))
+                LearnQuietly(itr->second);
+        }
+    }
+
+    static inline SilentSpellLearnBatch* currentBatch = nullptr;
+
+    Player* bot;
+    SilentSpellLearnBatch* previous;
+    bool active;
+    uint32 learnedCount = 0;
+};
+
+/* Per-class manifest of everything a trainer could teach this class.
+ * Everything about a trainer spell that does not depend on the bot is
+ * settled once: which trainers are worth asking, whether the spell is an
+ * epic class mount in disguise, and which skill line it belongs to. What is
+ * left is sorted by required level, so the spell pass stops at the bot's
+ * level and only asks CanTeachSpell about the survivors.
+ * Before each pass the manifest is checked against the live trainers: every
+ * trainer it read must still be the same object with the same number of
+ * spells, and every entry must still name the same spell at the same index
+ * with the same required level. A trainer reload that adds, drops or edits
+ * spells fails that check and the manifest is rebuilt. A trainer newly
+ * attached to a creature that had none is not visible from here; the
+ * manifests are also dropped on config reload, which picks that up.
+ */
+
+enum class TrainerSpellKind : uint8
+{
+    ClassSpell,
+    SecondaryProfession,
+    PrimaryProfession,
+};
+
+struct TrainerSpellManifestEntry
+{
+    Trainer::Trainer* trainer = nullptr;
+    uint32 spellIndex = 0;
+    uint32 spellId = 0;
+    uint32 reqLevel = 0;
+    bool castable = false;
+    TrainerSpellKind kind = TrainerSpellKind::ClassSpell;
+};
+
+struct TrainerSpellManifestSource
+{
+    uint32 creatureId = 0;
+    Trainer::Trainer const* trainer = nullptr;
+    size_t spellCount = 0;
+};
+
+struct TrainerSpellManifest
+{
+    bool built = false;
+    std::vector<TrainerSpellManifestSource> sources;
+    std::vector<TrainerSpellManifestEntry> entries;
+};
+
+std::array<TrainerSpellManifest, MAX_CLASSES>& GetTrainerSpellManifests()
+{
+    static std::array<TrainerSpellManifest, MAX_CLASSES> manifests;
+    return manifests;
+}
+
+void ClearTrainerSpellManifests()
+{
+    for (TrainerSpellManifest& manifest : GetTrainerSpellManifests())
+    {
+        manifest.built = false;
+        manifest.sources.clear();
+        manifest.entries.clear();
+    }
 }
 
-std::vector<uint32> const& GetTrainerIdsForClass(uint8 classId)
+void BuildTrainerSpellManifest(uint8 classId, TrainerSpellManifest& manifest)
 {
-    static std::unordered_map<uint8, std::vector<uint32>> trainerIdsByClass;
-    auto [it, inserted] = trainerIdsByClass.try_emplace(classId);
-    std::vector<uint32>& trainerIds = it->second;
+    manifest.sources.clear();
+    manifest.entries.clear();
 
-    if (!inserted)
-        return trainerIds;
+    std::unordered_set<Trainer::Trainer const*> seenTrainers;
+    std::unordered_map<uint32, std::vector<Trainer::Spell const*>> seenSpells;
 
     CreatureTemplateContainer const* creatureTemplateContainer = sObjectMgr->GetCreatureTemplates();
     for (CreatureTemplateContainer::const_iterator itr = creatureTemplateContainer->begin();
          itr != creatureTemplateContainer->end(); ++itr)
     {
-        Trainer::Trainer* trainer = sObjectMgr->GetTrainer(itr->first);
-        if (!trainer)
-            continue;
+        Trainer::Trainer* trainer = sObjectMgr->GetTrainer(itr->first);
+        if (!trainer || !seenTrainers.insert(trainer).second)
+            continue;
+
+        Trainer::Type const trainerType = trainer->GetTrainerType();
+        if (trainerType != Trainer::Type::Tradeskill && trainerType != Trainer::Type::Class)
+            continue;
+
+        /* Another class's trainer would fail IsTrainerValidForPlayer for every bot of ours. */
+
+        if (trainerType == Trainer::Type::Class && trainer->GetTrainerRequirement() &&
+            trainer->GetTrainerRequirement() != classId)
+            continue;
+
+        auto const& spells = trainer->GetSpells();
+        manifest.sources.push_back({ itr->first, trainer, spells.size() });
+
+        for (uint32 spellIndex = 0; spellIndex < spells.size(); ++spellIndex)
+        {
+            Trainer::Spell const& trainerSpell = spells[spellIndex];
+            if (SpellTeachesBlockedEpicClassMountSpellForClass(classId, trainerSpell.SpellId))
+                continue;
+
+            TrainerSpellKind kind = TrainerSpellKind::ClassSpell;
+            if (trainerType == Trainer::Type::Tradeskill)
+            {
+                uint32 const skillLine = ResolveTrainerSpellSkillLine(trainer, &trainerSpell);
+                if (IsSecondaryProfessionSkillId(skillLine))
+                    kind = TrainerSpellKind::SecondaryProfession;
+                else if (IsPrimaryProfessionSkillId(skillLine))
+                    kind = TrainerSpellKind::PrimaryProfession;
+                else
+                    continue;
+            }
+
+            /* Many trainers teach the same spell on the same terms; one copy is enough. */
+
+            std::vector<Trainer::Spell const*>& variants = seenSpells[trainerSpell.SpellId];
+            bool const duplicate = std::any_of(variants.begin(), variants.end(), [&](Trainer::Spell const* seen)
+            {
+                return seen->ReqLevel == trainerSpell.ReqLevel && seen->ReqSkillLine == trainerSpell.ReqSkillLine &&
+                       seen->ReqSkillRank == trainerSpell.ReqSkillRank && seen->ReqAbility == trainerSpell.ReqAbility;
+            });
+
+            if (duplicate)
+                continue;
+
+            variants.push_back(&trainerSpell);
+
+            TrainerSpellManifestEntry entry;
+            entry.trainer = trainer;
+            entry.spellIndex = spellIndex;
+            entry.spellId = trainerSpell.SpellId;
+            entry.reqLevel = trainerSpell.ReqLevel;
+            entry.castable = trainerSpell.IsCastable();
+            entry.kind = kind;
+            manifest.entries.push_back(entry);
+        }
+    }
+
+    std::stable_sort(manifest.entries.begin(), manifest.entries.end(),
+                     [](TrainerSpellManifestEntry const& left, TrainerSpellManifestEntry const& right)
+                     {
+                         return left.reqLevel < right.reqLevel;
+                     });
+}
+
+bool IsTrainerSpellManifestCurrent(TrainerSpellManifest const& manifest)
+{
+    for (TrainerSpellManifestSource const& source : manifest.sources)
+    {
+        Trainer::Trainer const* trainer = sObjectMgr->GetTrainer(source.creatureId);
+        if (trainer != source.trainer || trainer->GetSpells().size() != source.spellCount)
+            return false;
+    }
+
+    for (TrainerSpellManifestEntry const& entry : manifest.entries)
+    {
+        auto const& spells = entry.trainer->GetSpells();
+        if (entry.spellIndex >= spells.size() || spells[entry.spellIndex].SpellId != entry.spellId ||
+            spells[entry.spellIndex].ReqLevel != entry.reqLevel)
+            return false;
+    }
 
-        if (trainer->GetTrainerType() != Trainer::Type::Tradeskill && trainer->GetTrainerType() != Trainer::Type::Class)
-            continue;
+    return true;
+}
 
-        if (trainer->GetTrainerType() == Trainer::Type::Class)
-            trainerIds.push_back(itr->first);
-        else
-            trainerIds.push_back(itr->first);
-    }
+TrainerSpellManifest const* GetTrainerSpellManifest(uint8 classId)
+{
+    if (classId == 0 || classId >= MAX_CLASSES)
+        return nullptr;
 
-    return trainerIds;
+    return &RefreshSpellIndex(GetTrainerSpellManifests()[classId],
+                              [classId](TrainerSpellManifest& manifest) { BuildTrainerSpellManifest(classId, manifest); },
+                              IsTrainerSpellManifestCurrent);
 }
 
 void InitAvailableSpellsFiltered(Player* bot, bool allowPrimaryProfessionSpells)
@@ -3588,26 +5865,33 @@ void InitAvailableSpellsFiltered(Player* bot, bool allowPrimaryProfessionSpells)
     if (!bot)
         return;
 
-    for (uint32 trainerId : GetTrainerIdsForClass(bot->getClass()))
+    TrainerSpellManifest const* manifest = GetTrainerSpellManifest(bot->getClass());
+    if (!manifest)
+        return;
+
+    uint32 const level = bot->GetLevel();
+
+    for (TrainerSpellManifestEntry const& entry : manifest->entries)
     {
-        Trainer::Trainer* trainer = sObjectMgr->GetTrainer(trainerId);
-        if (!trainer)
+        if (entry.reqLevel > level)
+            break;
+
+        if (entry.kind == TrainerSpellKind::PrimaryProfession && !allowPrimaryProfessionSpells)
             continue;
 
-        if (trainer->GetTrainerType() == Trainer::Type::Class && !trainer->IsTrainerValidForPlayer(bot))
+        Trainer::Trainer* trainer = entry.trainer;
+        Trainer::Spell const* trainerSpell = &trainer->GetSpells()[entry.spellIndex];
+
+        if (entry.kind == TrainerSpellKind::ClassSpell && !trainer->IsTrainerValidForPlayer(bot))
             continue;
 
-        for (auto const& spell : trainer->GetSpells())
-        {
-            Trainer::Spell const* trainerSpell = trainer->GetSpell(spell.SpellId);
-            if (!ShouldTeachTrainerSpell(bot, trainer, trainerSpell, allowPrimaryProfessionSpells))
-                continue;
+        if (!trainer->CanTeachSpell(bot, trainerSpell))
+            continue;
 
-            if (trainerSpell->IsCastable())
-                bot->CastSpell(bot, trainerSpell->SpellId, true);
-            else
-                bot->learnSpell(trainerSpell->SpellId, false);
-        }
+        if (entry.castable)
+            bot->CastSpell(bot, entry.spellId, true);
+        else
+            SilentSpellLearnBatch::Learn(bot, entry.spellId);
     }
 }
 
@@ -3621,7 +5905,7 @@ void LearnSecondaryProfessionRanks(Player* bot, uint16 skillId, uint16 targetMax
         if (targetMaxSkill < rankSpell.requiredMaxSkill || bot->HasSpell(rankSpell.spellId))
             continue;
 
-        bot->learnSpell(rankSpell.spellId, false);
+        SilentSpellLearnBatch::Learn(bot, rankSpell.spellId);
     }
 }
 
@@ -3845,11 +6129,53 @@ void LearnSpellsForCurrentLevel(Player* bot)
     factory.InitSpecialSpells();
 }
 
+/* Per-bot spell watermark.
+ * The spell pass only ever learns, and what it can learn is decided by the
+ * bot's level, talents and secondary profession skills plus the manifests
+ * above. When none of that has moved since the last full pass, a re-spec has
+ * nothing new to teach and the pass is skipped outright.
+ */
+
+struct SpellWatermark
+{
+    uint64 signature = 0;
+    uint32 version = 0;
+};
+
+std::unordered_map<ObjectGuid, SpellWatermark>& GetSpellWatermarks()
+{
+    static std::unordered_map<ObjectGuid, SpellWatermark> watermarks;
+    return watermarks;
+}
+
+void ForgetSpellWatermark(Player* bot)
+{
+    if (bot)
+        GetSpellWatermarks().erase(bot->GetGUID());
+}
+
+uint64 ComputeSpellWatermarkSignature(Player* bot)
+{
+    uint64 signature = ComputeTalentSignature(bot);
+    for (uint16 skillId : GetSecondaryProfessionSkillIds())
+    {
+        signature = (signature ^ bot->GetSkillValue(skillId)) * 1099511628211ULL;
+        signature = (signature ^ bot->GetMaxSkillValue(skillId)) * 1099511628211ULL;
+    }
+
+    return signature;
+}
+
 void LearnBotSpellsForCurrentLevel(Player* bot)
 {
     if (!bot)
         return;
 
+    auto const watermarkIt = GetSpellWatermarks().find(bot->GetGUID());
+    if (watermarkIt != GetSpellWatermarks().end() && watermarkIt->second.version == GetSpellManifestVersion() &&
+        watermarkIt->second.signature == ComputeSpellWatermarkSignature(bot))
+        return;
+
     RidingStateSnapshot const ridingSnapshot = CaptureRidingState(bot);
     EpicClassMountSpellSnapshot const epicClassMountSnapshot = CaptureEpicClassMountSpellState(bot);
 
@@ -3861,6 +6187,10 @@ void LearnBotSpellsForCurrentLevel(Player* bot)
 
     if (RemoveNewlyGrantedEpicClassMountSpells(bot, epicClassMountSnapshot))
         RestoreRidingState(bot, ridingSnapshot);
+
+    SpellWatermark& watermark = GetSpellWatermarks()[bot->GetGUID()];
+    watermark.signature = ComputeSpellWatermarkSignature(bot);
+    watermark.version = GetSpellManifestVersion();
 }
 
 void ApplyGlyphStateForCap(Player* bot, ExpansionCap cap)
@@ -3886,16 +6216,13 @@ void ApplyClassBotGearAgainstMaster(Player* bot, Player* commandSender, ModuleCo
 
     if (useMasterRatio && targetAverageIlvl > 0.0f && gearScoreLimit != 0)
     {
-        for (uint8 attempt = 0; attempt < config.gearRetryCount; ++attempt)
-        {
-            DestroyOldGear(bot);
-            RunGearPass(bot, gearScoreLimit, config.gearQualityCapRatioMode, targetAverageIlvl, config);
-
-            if (IsGearWithinTargetBand(bot, targetAverageIlvl, config))
-                return;
-        }
+        NoteGearAttempt();
+        uint32 const missingSlots = RunGearPass(bot, gearScoreLimit, config.gearQualityCapRatioMode, targetAverageIlvl, config);
+        ReportMissingBandSlots(bot, missingSlots, targetAverageIlvl);
+        return;
     }
 
+    NoteGearAttempt();
     DestroyOldGear(bot);
     RunGearPass(bot, 0, config.gearQualityCapTopForLevel);
 }
@@ -3909,6 +6236,8 @@ bool ExecuteSetupCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
         return false;
     }
 
+    ScopedCommandTrace const commandTrace("setup", bot);
+    SilentSpellLearnBatch const spellBatch(bot, config.quietSpellLearn);
     SyncAddclassBotLevel(bot, commandSender);
 
     PlayerbotFactory factory(bot, bot->GetLevel());
@@ -3920,79 +6249,115 @@ bool ExecuteSetupCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
     Optional<PetSpecChoice> const savedPetSpec = LoadSavedPetSpec(bot);
     bool const useSavedHunterPetSpec = bot->getClass() == CLASS_HUNTER && savedPetSpec && bot->GetLevel() >= 10;
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceAttunementQs))
-        factory.InitAttunementQuests();
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Maintenance);
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceBags))
-        factory.InitBags(false);
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceAttunementQs))
+            factory.InitAttunementQuests();
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceAmmo))
-        factory.InitAmmo();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceBags))
+            factory.InitBags(false);
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceFood))
-        factory.InitFood();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceAmmo))
+            factory.InitAmmo();
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceReagents))
-        factory.InitReagents();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceFood))
+            factory.InitFood();
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceConsumables))
-        factory.InitConsumables();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceReagents))
+            factory.InitReagents();
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenancePotions))
-        factory.InitPotions();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceConsumables))
+            factory.InitConsumables();
+
+        if (shouldRun(sPlayerbotAIConfig.altMaintenancePotions))
+            factory.InitPotions();
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceTalentTree))
     {
+        ScopedStageTimer const stageTimer(CommandStage::Talents);
         factory.InitTalentsTree(true);
         ReapplySetupTalentsForCap(bot, setupCap);
     }
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenancePet) && !useSavedHunterPetSpec)
-        factory.InitPet();
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Pet);
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenancePetTalents) && !useSavedHunterPetSpec)
-        factory.InitPetTalents();
+        if (shouldRun(sPlayerbotAIConfig.altMaintenancePet) && !useSavedHunterPetSpec)
+            factory.InitPet();
+
+        if (shouldRun(sPlayerbotAIConfig.altMaintenancePetTalents) && !useSavedHunterPetSpec)
+            factory.InitPetTalents();
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceSkills))
     {
+        ScopedStageTimer const stageTimer(CommandStage::Skills);
         factory.InitSkills();
         ApplySetupRidingPolicy(bot, ridingSnapshot, setupCap);
         GrantSecondaryProfessions(bot, setupCap);
     }
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceClassSpells))
-        factory.InitClassSpells();
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Spells);
+
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceClassSpells))
+            factory.InitClassSpells();
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceAvailableSpells))
-        InitAvailableSpellsFiltered(bot, false);
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceAvailableSpells))
+            InitAvailableSpellsFiltered(bot, false);
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceReputation))
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Reputation);
         factory.InitReputation();
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceSpecialSpells))
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Spells);
         factory.InitSpecialSpells();
+    }
 
-    bool const removedEpicClassMount = RemoveNewlyGrantedEpicClassMountSpells(bot, epicClassMountSnapshot);
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceSkills))
-        ApplySetupRidingPolicy(bot, ridingSnapshot, setupCap);
-    else if (removedEpicClassMount)
-        RestoreRidingState(bot, ridingSnapshot);
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Mounts);
 
-    if (shouldRun(sPlayerbotAIConfig.altMaintenanceMounts))
-        factory.InitMounts();
+        bool const removedEpicClassMount = RemoveNewlyGrantedEpicClassMountSpells(bot, epicClassMountSnapshot);
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceSkills))
+            ApplySetupRidingPolicy(bot, ridingSnapshot, setupCap);
+        else if (removedEpicClassMount)
+            RestoreRidingState(bot, ridingSnapshot);
+
+        if (shouldRun(sPlayerbotAIConfig.altMaintenanceMounts))
+            factory.InitMounts();
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceGlyphs))
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Glyphs);
         ApplyGlyphStateForCap(bot, setupCap);
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceKeyring))
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Maintenance);
         factory.InitKeyring();
+    }
 
     if (shouldRun(sPlayerbotAIConfig.altMaintenanceGemsEnchants) && bot->GetLevel() >= sPlayerbotAIConfig.minEnchantingBotLevel)
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Enchants);
         factory.ApplyEnchantAndGemsNew();
+    }
 
-    bot->DurabilityRepairAll(false, 1.0f, false);
-    bot->SendTalentsInfoData(false);
-    ResetBotAIAndActions(botAI);
+    {
+        ScopedStageTimer const stageTimer(CommandStage::AIReset);
+        bot->DurabilityRepairAll(false, 1.0f, false);
+        bot->SendTalentsInfoData(false);
+        ResetBotAIAndActions(botAI);
+    }
 
     if (bot->getClass() == CLASS_PALADIN)
     {
@@ -4001,6 +6366,8 @@ bool ExecuteSetupCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
             NormalizePaladinRighteousFury(bot, botAI, resolved.definition);
     }
 
+    ScopedStageTimer const petStageTimer(CommandStage::Pet);
+
     if (bot->getClass() == CLASS_HUNTER)
     {
         if (savedPetSpec && bot->GetLevel() >= 10)
@@ -4034,6 +6401,9 @@ bool ExecuteRestockCommand(Player* bot, PlayerbotAI* botAI)
     if (!bot || !botAI)
         return false;
 
+    ScopedCommandTrace const commandTrace("restock", bot);
+    ScopedStageTimer const stageTimer(CommandStage::Maintenance);
+
     PlayerbotFactory factory(bot, bot->GetLevel());
     bool const isAltBot = botAI->IsAlt();
     auto const shouldRun = [isAltBot](bool altGate) { return !isAltBot || altGate; };
@@ -4157,6 +6527,9 @@ bool ExecuteSpecCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
         return false;
     }
 
+    ScopedCommandTrace const commandTrace("spec", bot);
+    SilentSpellLearnBatch const spellBatch(bot, config.quietSpellLearn);
+
     switch (command.specControlAction)
     {
         case SpecControlAction::ManualOn:
@@ -4179,7 +6552,7 @@ bool ExecuteSpecCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
     ResolvedSpec resolved;
     if (!ResolveRequestedSpec(bot, command.specProfile, resolved, true) || !resolved.definition)
     {
-        errorMessage = "invalid profile '" + command.specProfile + "' for " + bot->GetName() + ". " + BuildSpecListMessage(bot);
+        errorMessage = "invalid profile '" + std::string(command.specProfile) + "' for " + bot->GetName() + ". " + BuildSpecListMessage(bot);
         return false;
     }
 
@@ -4195,38 +6568,61 @@ bool ExecuteSpecCommand(Player* commandSender, Player* bot, PlayerbotAI* botAI,
 
     RidingStateGuard const ridingGuard(bot, botAI->IsAlt());
     ExpansionCap const cap = ResolveExpansionCap(bot, config);
-    if (!ApplySpecTalents(bot, specNo, cap))
     {
-        errorMessage = "failed to apply spec for " + bot->GetName() + '.';
-        return false;
+        ScopedStageTimer const stageTimer(CommandStage::Talents);
+        if (!ApplySpecTalents(bot, specNo, cap))
+        {
+            errorMessage = "failed to apply spec for " + bot->GetName() + '.';
+            return false;
+        }
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Spells);
+        LearnBotSpellsForCurrentLevel(bot);
     }
 
-    LearnBotSpellsForCurrentLevel(bot);
     if (config.autoGearRndBots)
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Gear);
         ApplyClassBotGearAgainstMaster(bot, commandSender, config);
-    ApplyGlyphStateForCap(bot, cap);
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Glyphs);
+        ApplyGlyphStateForCap(bot, cap);
+    }
 
     PlayerbotFactory factory(bot, bot->GetLevel());
     if (bot->GetLevel() >= sPlayerbotAIConfig.minEnchantingBotLevel)
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Enchants);
         factory.ApplyEnchantAndGemsNew();
+    }
 
     Optional<PetSpecChoice> savedPetSpec = LoadSavedPetSpec(bot);
     if (bot->getClass() == CLASS_HUNTER)
     {
         if (!savedPetSpec)
         {
+            ScopedStageTimer const stageTimer(CommandStage::Pet);
             factory.InitPet();
             factory.InitPetTalents();
             SetPetTankState(bot, false);
         }
     }
 
-    bot->SendTalentsInfoData(false);
-    ResetBotAIAndActions(botAI);
+    {
+        ScopedStageTimer const stageTimer(CommandStage::AIReset);
+        bot->SendTalentsInfoData(false);
+        ResetBotAIAndActions(botAI);
+    }
 
     if (bot->getClass() == CLASS_PALADIN)
         NormalizePaladinRighteousFury(bot, botAI, resolved.definition);
 
+    ScopedStageTimer const petStageTimer(CommandStage::Pet);
+
     if (bot->getClass() == CLASS_HUNTER && savedPetSpec && bot->GetLevel() >= 10)
     {
         if (!ConfigureHunterPetSpec(bot, savedPetSpec.value(), botAI->IsAlt(), errorMessage))
@@ -4257,6 +6653,9 @@ bool ExecutePetSpecCommand(Player* bot, PlayerbotAI* botAI, ParsedBotCommand con
         return false;
     }
 
+    ScopedCommandTrace const commandTrace("petspec", bot);
+    ScopedStageTimer const stageTimer(CommandStage::Pet);
+
     if (bot->getClass() == CLASS_HUNTER)
     {
         if (!ConfigureHunterPetSpec(bot, command.petSpecChoice, botAI->IsAlt(), errorMessage))
@@ -4297,6 +6696,7 @@ struct CommandResult
     uint32 matched = 0;
     uint32 updated = 0;
     uint32 failed = 0;
+    uint32 coalesced = 0;
     bool handled = false;
 };
 
@@ -4318,29 +6718,309 @@ char const* GetCommandLabel(BotCommandType type)
     }
 }
 
-bool CheckMasterControl(Player* commandSender, Player* bot, ModuleConfig const& config)
+bool CheckMasterControl(Player* commandSender, Player* bot, ModuleConfig const& config)
+{
+    /* Config can disable ownership checks entirely for wide-open admin setups. */
+
+    if (!config.requireMasterControl)
+        return true;
+
+    if (!commandSender || !commandSender->GetSession())
+        return false;
+
+    /* GM bypass exists for admin triage and operational emergencies. */
+
+    if (commandSender->GetSession()->GetSecurity() >= SEC_GAMEMASTER)
+        return true;
+
+    /* Default path: only the owning master gets to command the bot. */
+
+    PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot);
+    return botAI && botAI->GetMaster() == commandSender;
+}
+
+void ReportSummary(Player* commandSender, CommandResult const& result)
+{
+    if (!result.handled)
+        return;
+
+    ChatHandler handler(commandSender->GetSession());
+
+    std::ostringstream out;
+    out << "bettersetup: matched " << result.matched << ", updated " << result.updated << ", failed " << result.failed;
+    if (result.coalesced)
+        out << ", coalesced " << result.coalesced;
+    out << '.';
+    handler.SendSysMessage(out.str());
+}
+
+/* Background command jobs.
+ * Chat hooks only validate and queue; the heavy setup/spec/restock/petspec
+ * work is drained from WorldScript::OnUpdate inside a per-tick time budget, so
+ * a raid-wide setup spreads over several ticks instead of stalling one. Jobs
+ * hold GUIDs and re-resolve them when they run, because either side may have
+ * logged out in the meantime. Each fan-out is one batch, and the summary goes
+ * out when its last job finishes.
+ */
+
+struct CommandBatch
+{
+    ObjectGuid commandSender;
+    CommandResult result;
+    uint32 pending = 0;
+    uint32 fanout = 0;
+    std::shared_ptr<ModuleConfig const> config;
+};
+
+struct CommandJob
+{
+    std::shared_ptr<CommandBatch> batch;
+    ObjectGuid bot;
+    ParsedBotCommand command;
+    std::string specProfile;
+    bool cancelled = false;
+};
+
+std::deque<CommandJob>& GetCommandJobQueue()
+{
+    static std::deque<CommandJob> queue;
+    return queue;
+}
+
+/* Pending-command table for coalescing bursts.
+ * One queued job per bot and command kind: a repeat of a queued command is
+ * dropped, a different spec or petspec supersedes the queued one, and setup
+ * already covers everything restock does. Superseded jobs stay in the queue
+ * flagged as cancelled so the queue never has to be searched. Spec manual and
+ * switch are toggles, not idempotent orders, so they are never coalesced.
+ */
+
+using PendingCommandKey = std::pair<ObjectGuid, BotCommandType>;
+
+std::map<PendingCommandKey, CommandJob*>& GetPendingCommandJobs()
+{
+    static std::map<PendingCommandKey, CommandJob*> pending;
+    return pending;
+}
+
+bool IsCoalescableCommand(ParsedBotCommand const& command)
+{
+    return command.type != BotCommandType::None && command.specControlAction == SpecControlAction::None;
+}
+
+CommandJob* FindPendingCommandJob(ObjectGuid bot, BotCommandType type)
+{
+    auto& pending = GetPendingCommandJobs();
+    auto const itr = pending.find({ bot, type });
+    return itr != pending.end() ? itr->second : nullptr;
+}
+
+bool IsSameQueuedCommand(CommandJob const& job, ParsedBotCommand const& command)
+{
+    return job.command.petSpecChoice == command.petSpecChoice && NormalizeToken(job.specProfile) == NormalizeToken(command.specProfile);
+}
+
+void ReleaseCommandBatch(CommandBatch& batch)
+{
+    if (!batch.pending || --batch.pending)
+        return;
+
+    Player* commandSender = ObjectAccessor::FindConnectedPlayer(batch.commandSender);
+    if (commandSender && commandSender->GetSession())
+        ReportSummary(commandSender, batch.result);
+}
+
+void CancelPendingCommandJob(CommandJob& job)
+{
+    GetPendingCommandJobs().erase({ job.bot, job.command.type });
+    job.cancelled = true;
+    job.batch->result.coalesced++;
+    ReleaseCommandBatch(*job.batch);
+}
+
+/* Returns true when the new command is already covered by queued work. */
+
+bool CoalesceWithPendingJobs(ObjectGuid bot, ParsedBotCommand const& command)
+{
+    if (command.type == BotCommandType::Restock && FindPendingCommandJob(bot, BotCommandType::Setup))
+        return true;
+
+    if (CommandJob* pending = FindPendingCommandJob(bot, command.type))
+    {
+        if (IsSameQueuedCommand(*pending, command))
+            return true;
+
+        CancelPendingCommandJob(*pending);
+    }
+
+    if (command.type == BotCommandType::Setup)
+    {
+        if (CommandJob* restock = FindPendingCommandJob(bot, BotCommandType::Restock))
+            CancelPendingCommandJob(*restock);
+    }
+
+    return false;
+}
+
+void RunCommandJob(CommandJob& job)
+{
+    CommandBatch& batch = *job.batch;
+
+    Player* bot = ObjectAccessor::FindConnectedPlayer(job.bot);
+    PlayerbotAI* botAI = bot ? GET_PLAYERBOT_AI(bot) : nullptr;
+    if (!botAI)
+    {
+        batch.result.failed++;
+        ReleaseCommandBatch(batch);
+        return;
+    }
+
+    /* The queued copy owns its text; point the parsed view back at it. */
+
+    ParsedBotCommand command = job.command;
+    command.specProfile = job.specProfile;
+
+    Player* commandSender = ObjectAccessor::FindConnectedPlayer(batch.commandSender);
+    ModuleConfig const& config = *batch.config;
+    std::string errorMessage;
+    bool success = false;
+    currentCommandFanout = batch.fanout;
+
+    switch (command.type)
+    {
+        case BotCommandType::Setup:
+            success = ExecuteSetupCommand(commandSender, bot, botAI, config, errorMessage);
+            break;
+        case BotCommandType::Spec:
+            success = ExecuteSpecCommand(commandSender, bot, botAI, config, command, errorMessage);
+            break;
+        case BotCommandType::Restock:
+            success = ExecuteRestockCommand(bot, botAI);
+            break;
+        case BotCommandType::PetSpec:
+            success = ExecutePetSpecCommand(bot, botAI, command, errorMessage);
+            break;
+        case BotCommandType::None:
+        default:
+            break;
+    }
+
+    currentCommandFanout = 1;
+
+    if (success)
+    {
+        batch.result.updated++;
+    }
+    else
+    {
+        batch.result.failed++;
+        if (errorMessage.empty())
+            errorMessage = "command failed for " + bot->GetName() + '.';
+        botAI->TellMasterNoFacing(std::string(GetCommandLabel(command.type)) + ": " + errorMessage);
+    }
+
+    ReleaseCommandBatch(batch);
+}
+
+void EnqueueCommandJob(std::shared_ptr<CommandBatch> const& batch, Player* bot, ParsedBotCommand const& command,
+                       ModuleConfig const& config)
+{
+    CommandJob job;
+    job.batch = batch;
+    job.bot = bot->GetGUID();
+    job.command = command;
+    job.command.specProfile = {};
+    job.specProfile = std::string(command.specProfile);
+
+    /* With the scheduler off, the job runs right here in the chat hook, as it always used to. */
+
+    if (!config.schedulerEnable)
+    {
+        batch->pending++;
+        RunCommandJob(job);
+        return;
+    }
+
+    bool const coalescable = IsCoalescableCommand(command);
+    if (coalescable && CoalesceWithPendingJobs(job.bot, command))
+    {
+        batch->result.coalesced++;
+        return;
+    }
+
+    batch->pending++;
+
+    std::deque<CommandJob>& queue = GetCommandJobQueue();
+    queue.push_back(std::move(job));
+
+    if (coalescable)
+        GetPendingCommandJobs()[{ queue.back().bot, queue.back().command.type }] = &queue.back();
+}
+
+void DrainCommandJobs(uint32 tickBudgetMs)
+{
+    std::deque<CommandJob>& queue = GetCommandJobQueue();
+    if (queue.empty())
+        return;
+
+    /* At least one job per tick, so a tiny budget slows the queue but never stalls it. */
+
+    auto const start = std::chrono::steady_clock::now();
+    auto const budget = std::chrono::milliseconds(tickBudgetMs);
+
+    do
+    {
+        if (!queue.front().cancelled)
+        {
+            auto& pending = GetPendingCommandJobs();
+            auto const itr = pending.find({ queue.front().bot, queue.front().command.type });
+            if (itr != pending.end() && itr->second == &queue.front())
+                pending.erase(itr);
+        }
+
+        CommandJob job = std::move(queue.front());
+        queue.pop_front();
+
+        if (!job.cancelled)
+            RunCommandJob(job);
+    } while (!queue.empty() && std::chrono::steady_clock::now() - start < budget);
+}
+
+BotSelectorDescriptor DescribeBotForSelectors(Player* bot, PlayerbotAI* botAI, bool withRoles)
 {
-    /* Config can disable ownership checks entirely for wide-open admin setups. */
+    BotSelectorDescriptor descriptor;
+    descriptor.classId = bot->getClass();
+    descriptor.level = bot->GetLevel();
+    descriptor.subGroup = bot->GetGroup() ? bot->GetSubGroup() + 1 : 0;
 
-    if (!config.requireMasterControl)
-        return true;
+    /* Role checks walk talents and strategies, so only pay for them when asked. */
 
-    if (!commandSender || !commandSender->GetSession())
-        return false;
+    if (withRoles)
+    {
+        descriptor.tank = botAI->IsTank(bot);
+        descriptor.heal = botAI->IsHeal(bot);
+    }
 
-    /* GM bypass exists for admin triage and operational emergencies. */
+    return descriptor;
+}
 
-    if (commandSender->GetSession()->GetSecurity() >= SEC_GAMEMASTER)
-        return true;
+/* Verification mode runs the upstream filter next to every compiled selector
+ * and trusts the filter. Disagreements are logged so they can be fixed here.
+ */
 
-    /* Default path: only the owning master gets to command the bot. */
+void VerifyCompiledSelector(Player* bot, PlannedCommand const& planned, BotSelectorDescriptor const& descriptor,
+                            std::string const& filtered, bool filterRuns)
+{
+    bool const compiledRuns = MatchesCompiledSelector(planned.selector, descriptor);
+    if (compiledRuns == filterRuns && (!filterRuns || filtered == planned.commandText))
+        return;
 
-    PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot);
-    return botAI && botAI->GetMaster() == commandSender;
+    LOG_ERROR("module", "mod-playerbot-bettersetup: compiled selector for '{}' {} {} but CompositeChatFilter left '{}'.",
+              planned.text, compiledRuns ? "matched" : "skipped", bot->GetName(), filtered);
 }
 
-bool ProcessModuleCommandsForBot(Player* commandSender, uint32 chatType, std::string const& originalMessage, Player* bot,
-                                 ModuleConfig const& config, CommandResult& result)
+bool ProcessModuleCommandsForBot(Player* commandSender, uint32 chatType, CommandPlan const& plan, Player* bot,
+                                 ModuleConfig const& config, std::shared_ptr<CommandBatch> const& batch)
 {
     PlayerbotAI* botAI = GET_PLAYERBOT_AI(bot);
     if (!botAI)
@@ -4349,36 +7029,45 @@ bool ProcessModuleCommandsForBot(Player* commandSender, uint32 chatType, std::st
     if (!botAI->GetSecurity()->CheckLevelFor(PLAYERBOT_SECURITY_ALLOW_ALL, chatType != CHAT_MSG_WHISPER, commandSender))
         return false;
 
-    std::vector<std::string> commands = SplitCommands(originalMessage, sPlayerbotAIConfig.commandSeparator);
+    BotSelectorDescriptor const descriptor = DescribeBotForSelectors(bot, botAI, plan.needsRoles);
     bool processedAny = false;
 
-    for (std::string command : commands)
+    for (PlannedCommand const& planned : plan.commands)
     {
-        command = TrimCopy(command);
-        if (command.empty())
-            continue;
+        std::string filtered;
+        ParsedBotCommand parsed;
 
-        if (!sPlayerbotAIConfig.commandPrefix.empty())
+        if (planned.selector.compiled && !config.verifyCompiledSelectors)
         {
-            if (!StartsWith(command, sPlayerbotAIConfig.commandPrefix))
+            if (!MatchesCompiledSelector(planned.selector, descriptor))
                 continue;
 
-            command = TrimCopy(command.substr(sPlayerbotAIConfig.commandPrefix.size()));
-            if (command.empty())
-                continue;
+            parsed = planned.parsed;
         }
+        else
+        {
+            /* The filter normally just peels the selectors this bot matched, leaving
+             * the pre-parsed text. Anything it left behind gets a private parse.
+             */
 
-        std::string filtered = command;
-        CompositeChatFilter selectorFilter(botAI);
-        filtered = TrimCopy(selectorFilter.Filter(filtered));
-        if (filtered.empty())
-            continue;
+            CompositeChatFilter selectorFilter(botAI);
+            filtered = std::string(planned.text);
+            filtered = TrimCopy(selectorFilter.Filter(filtered));
+
+            if (filtered == planned.commandText)
+                parsed = planned.parsed;
+            else if (!filtered.empty())
+                parsed = ParseBotCommand(filtered);
+
+            if (planned.selector.compiled)
+                VerifyCompiledSelector(bot, planned, descriptor, filtered, parsed.type != BotCommandType::None);
+        }
 
-        ParsedBotCommand parsed = ParseBotCommand(filtered);
         if (parsed.type == BotCommandType::None)
             continue;
 
         processedAny = true;
+        CommandResult& result = batch->result;
         result.handled = true;
         result.matched++;
 
@@ -4403,42 +7092,11 @@ bool ProcessModuleCommandsForBot(Player* commandSender, uint32 chatType, std::st
         if (!parsed.errorMessage.empty())
         {
             result.failed++;
-            botAI->TellMasterNoFacing(std::string(label) + ": " + parsed.errorMessage);
-            continue;
-        }
-
-        std::string errorMessage;
-        bool success = false;
-
-        switch (parsed.type)
-        {
-            case BotCommandType::Setup:
-                success = ExecuteSetupCommand(commandSender, bot, botAI, config, errorMessage);
-                break;
-            case BotCommandType::Spec:
-                success = ExecuteSpecCommand(commandSender, bot, botAI, config, parsed, errorMessage);
-                break;
-            case BotCommandType::Restock:
-                success = ExecuteRestockCommand(bot, botAI);
-                break;
-            case BotCommandType::PetSpec:
-                success = ExecutePetSpecCommand(bot, botAI, parsed, errorMessage);
-                break;
-            case BotCommandType::None:
-            default:
-                break;
-        }
-
-        if (!success)
-        {
-            result.failed++;
-            if (errorMessage.empty())
-                errorMessage = "command failed for " + bot->GetName() + '.';
-            botAI->TellMasterNoFacing(std::string(label) + ": " + errorMessage);
+            botAI->TellMasterNoFacing(std::string(label) + ": " + std::string(parsed.errorMessage));
             continue;
         }
 
-        result.updated++;
+        EnqueueCommandJob(batch, bot, parsed, config);
     }
 
     return processedAny;
@@ -4500,8 +7158,93 @@ std::vector<Player*> CollectGuildBots(Player* commandSender)
     return bots;
 }
 
+/* Random-bot roster for channel fan-out.
+ * Channel lookups are per faction, so a channel line only needs to know which
+ * factions can see the channel and which random bots belong to each. The
+ * roster is seeded from sRandomPlayerbotMgr on first use and then kept current
+ * by the login and logout hooks, so a channel line no longer pays a
+ * string-keyed channel lookup per random bot.
+ */
+
+struct RandomBotRoster
+{
+    std::array<std::vector<ObjectGuid>, PVP_TEAMS_COUNT> teams;
+    std::unordered_map<ObjectGuid, std::pair<TeamId, size_t>> slots;
+    bool seeded = false;
+};
+
+RandomBotRoster& GetRandomBotRoster()
+{
+    static RandomBotRoster roster;
+    return roster;
+}
+
+void AddToRandomBotRoster(Player* bot)
+{
+    TeamId const team = bot->GetTeamId();
+    if (team >= PVP_TEAMS_COUNT)
+        return;
+
+    RandomBotRoster& roster = GetRandomBotRoster();
+    if (roster.slots.find(bot->GetGUID()) != roster.slots.end())
+        return;
+
+    roster.slots.emplace(bot->GetGUID(), std::make_pair(team, roster.teams[team].size()));
+    roster.teams[team].push_back(bot->GetGUID());
+}
+
+void RemoveFromRandomBotRoster(ObjectGuid guid)
+{
+    RandomBotRoster& roster = GetRandomBotRoster();
+    auto const slotIt = roster.slots.find(guid);
+    if (slotIt == roster.slots.end())
+        return;
+
+    /* Swap-remove keeps logout O(1); roster order carries no meaning. */
+
+    std::vector<ObjectGuid>& members = roster.teams[slotIt->second.first];
+    size_t const index = slotIt->second.second;
+    if (index + 1 != members.size())
+    {
+        members[index] = members.back();
+        roster.slots[members[index]].second = index;
+    }
+
+    members.pop_back();
+    roster.slots.erase(slotIt);
+}
+
+RandomBotRoster& GetSeededRandomBotRoster()
+{
+    RandomBotRoster& roster = GetRandomBotRoster();
+    if (roster.seeded)
+        return roster;
+
+    for (auto itr = sRandomPlayerbotMgr.GetPlayerBotsBegin(); itr != sRandomPlayerbotMgr.GetPlayerBotsEnd(); ++itr)
+    {
+        if (Player* bot = itr->second)
+            AddToRandomBotRoster(bot);
+    }
+
+    roster.seeded = true;
+    return roster;
+}
+
+void TrackRandomBotLogin(Player* player)
+{
+    if (player && sRandomPlayerbotMgr.IsRandomBot(player))
+        AddToRandomBotRoster(player);
+}
+
+void TrackRandomBotLogout(Player* player)
+{
+    if (player)
+        RemoveFromRandomBotRoster(player->GetGUID());
+}
+
 /* Channel targeting, including named channels and random bot population.
  * Membership is checked through ChannelMgr to avoid touching private Channel internals.
+ * The lookup only depends on the faction, so it runs once per faction per message.
  * It is not glamorous work, but neither is mopping after a desynced channel list.
  */
 
@@ -4511,8 +7254,22 @@ std::vector<Player*> CollectChannelBots(Player* commandSender, Channel* channel)
     if (!channel)
         return bots;
 
-    std::set<ObjectGuid> seen;
     std::string const channelName = channel->GetName();
+    std::array<bool, PVP_TEAMS_COUNT> channelOnTeam = {};
+
+    for (uint8 team = 0; team < PVP_TEAMS_COUNT; ++team)
+    {
+        if (ChannelMgr* channelMgr = ChannelMgr::forTeam(static_cast<TeamId>(team)))
+            channelOnTeam[team] = channelMgr->GetChannel(channelName, commandSender, false) != nullptr;
+    }
+
+    auto const botSeesChannel = [&channelOnTeam](Player* bot)
+    {
+        TeamId const team = bot->GetTeamId();
+        return team < PVP_TEAMS_COUNT && channelOnTeam[team];
+    };
+
+    std::set<ObjectGuid> seen;
 
     /* Pass one: managed playerbots from this master's manager context. */
 
@@ -4526,15 +7283,8 @@ std::vector<Player*> CollectChannelBots(Player* commandSender, Channel* channel)
                 if (!bot || !GET_PLAYERBOT_AI(bot))
                     continue;
 
-                if (ChannelMgr* channelMgr = ChannelMgr::forTeam(bot->GetTeamId()))
-                {
-                    if (!channelMgr->GetChannel(channelName, bot, false))
-                        continue;
-                }
-                else
-                {
+                if (!botSeesChannel(bot))
                     continue;
-                }
 
                 if (!seen.insert(bot->GetGUID()).second)
                     continue;
@@ -4544,44 +7294,45 @@ std::vector<Player*> CollectChannelBots(Player* commandSender, Channel* channel)
         }
     }
 
-    /* Pass two: random bot pool currently present in the same channel. */
+    /* Pass two: random bot pool, walking only the factions that can see the channel. */
 
-    for (auto itr = sRandomPlayerbotMgr.GetPlayerBotsBegin(); itr != sRandomPlayerbotMgr.GetPlayerBotsEnd(); ++itr)
+    RandomBotRoster const& roster = GetSeededRandomBotRoster();
+
+    for (uint8 team = 0; team < PVP_TEAMS_COUNT; ++team)
     {
-        Player* bot = itr->second;
-        if (!bot || !GET_PLAYERBOT_AI(bot))
+        if (!channelOnTeam[team])
             continue;
 
-        if (ChannelMgr* channelMgr = ChannelMgr::forTeam(bot->GetTeamId()))
+        for (ObjectGuid const& guid : roster.teams[team])
         {
-            if (!channelMgr->GetChannel(channelName, bot, false))
+            /* Resolving through the holder keeps the set identical to its own bot map. */
+
+            Player* bot = sRandomPlayerbotMgr.GetPlayerBot(guid);
+            if (!bot || !GET_PLAYERBOT_AI(bot))
                 continue;
-        }
-        else
-            continue;
 
-        if (!seen.insert(bot->GetGUID()).second)
-            continue;
+            if (!seen.empty() && seen.count(guid))
+                continue;
 
-        bots.push_back(bot);
+            bots.push_back(bot);
+        }
     }
 
     return bots;
 }
 
-void ReportSummary(Player* commandSender, CommandResult const& result)
-{
-    if (!result.handled)
-        return;
-
-    ChatHandler handler(commandSender->GetSession());
+/* Gate every chat hook before target collection: one pointer load for the
+ * config snapshot, then a single pass over the raw message.
+ */
 
-    std::ostringstream out;
-    out << "bettersetup: matched " << result.matched << ", updated " << result.updated << ", failed " << result.failed << '.';
-    handler.SendSysMessage(out.str());
+bool ShouldInspectChatMessage(std::string const& message)
+{
+    return GetModuleConfig()->enabled && MessageMayContainModuleCommand(message);
 }
 
-/* Load config once per incoming chat event, fan out to chosen targets, then summarize. */
+/* Read the published config and build the command plan once per incoming chat event,
+ * fan out to chosen targets, then summarize once the queued jobs are done.
+ */
 
 void ProcessTargets(Player* commandSender, uint32 chatType, std::string const& message, std::vector<Player*> const& targets)
 {
@@ -4590,21 +7341,34 @@ void ProcessTargets(Player* commandSender, uint32 chatType, std::string const& m
 
     /* One config snapshot per incoming message keeps behavior consistent per fan-out. */
 
-    ModuleConfig const config = LoadModuleConfig();
+    std::shared_ptr<ModuleConfig const> const configSnapshot = GetModuleConfig();
+    ModuleConfig const& config = *configSnapshot;
     if (!config.enabled)
         return;
 
-    CommandResult result;
+    CommandPlan const plan = BuildCommandPlan(message);
+    if (plan.commands.empty())
+        return;
+
+    /* The fan-out itself holds one pending slot, so jobs that finish inline
+     * cannot report before every target has been queued.
+     */
+
+    auto batch = std::make_shared<CommandBatch>();
+    batch->commandSender = commandSender->GetGUID();
+    batch->pending = 1;
+    batch->fanout = static_cast<uint32>(targets.size());
+    batch->config = configSnapshot;
 
     for (Player* bot : targets)
     {
         if (!bot)
             continue;
 
-        ProcessModuleCommandsForBot(commandSender, chatType, message, bot, config, result);
+        ProcessModuleCommandsForBot(commandSender, chatType, plan, bot, config, batch);
     }
 
-    ReportSummary(commandSender, result);
+    ReleaseCommandBatch(*batch);
 }
 
 uint32 GetSpecPlayerTargetAverageIlvl(uint8 targetLevel, ModuleConfig const& config)
@@ -4620,39 +7384,147 @@ uint32 GetSpecPlayerTargetAverageIlvl(uint8 targetLevel, ModuleConfig const& con
     }
 }
 
-void ApplySpecPlayerGear(Player* player, uint8 targetLevel, ModuleConfig const& config)
+/* Gear-score limit solver for `.specplayer`.
+ * The factory takes the best item whose mixed gear score fits under the
+ * limit, so the average ilvl it lands on can only rise with the limit. Per
+ * slot, the candidate index gives a step function "limit -> best ilvl under
+ * it"; the limit is bisected against the average of those steps, and the
+ * real gear pass then runs once instead of chasing the target pass by pass.
+ */
+
+using GearLimitSteps = std::vector<std::pair<uint32, uint32>>;
+
+std::vector<GearLimitSteps> BuildGearLimitSteps(Player* bot, uint32 qualityLimit, uint8 levelSearchWindow)
 {
-    float const targetAverageIlvl = static_cast<float>(GetSpecPlayerTargetAverageIlvl(targetLevel, config));
-    uint32 const targetIlvl = static_cast<uint32>(targetAverageIlvl);
-    uint32 gearScoreLimit = ComputeGearScoreLimitFromAverageIlvl(targetAverageIlvl);
+    std::vector<GearLimitSteps> slotSteps;
+
+    int32 const level = static_cast<int32>(bot->GetLevel());
+    int32 const minLevel = std::max(level - std::min(level, static_cast<int32>(levelSearchWindow)), 1);
+    uint32 const preferredArmorSubClass = GetPreferredArmorSubClass(bot);
+    BotEquipCapabilities const capabilities = BuildBotEquipCapabilities(bot);
+    GearCandidateQuery const baseQuery = BuildGearCandidateQuery(ITEM_QUALITY_UNCOMMON, qualityLimit, 0.0f, nullptr);
+    std::vector<GearCandidate const*> candidates;
 
-    for (uint8 attempt = 0; attempt < config.specPlayerGearRetryCount; ++attempt)
+    for (uint8 slot : GetBandPlannerSlots())
     {
-        DestroyOldGear(player);
+        GearCandidateQuery query = baseQuery;
+        if (IsPrimaryArmorSlot(slot))
+        {
+            query.armorOnly = true;
+            query.anySubClass = false;
+            query.subClass = preferredArmorSubClass;
+        }
 
-        /* Specplayer should stay in green/blue/purple bands and also correct
-         * individual outlier slots toward the requested average ilvl.
-         */
-        RunGearPass(player, gearScoreLimit, config.specPlayerGearQualityCap, targetAverageIlvl, config, true,
-                    config.specPlayerGearLevelSearchWindow);
+        GearLimitSteps steps;
+        for (int32 requiredLevel = level; requiredLevel >= minLevel; --requiredLevel)
+        {
+            for (InventoryType inventoryType : GetInventoryTypesForSlot(slot))
+            {
+                CollectGearCandidates(GetGearCandidateBucket(requiredLevel, inventoryType), query, candidates);
 
-        uint32 const currentIlvl = static_cast<uint32>(player->GetAverageItemLevelForDF());
-        if (currentIlvl == 0 || IsSpecPlayerGearWithinTargetBand(player, targetAverageIlvl, config))
-            break;
+                for (GearCandidate const* candidate : candidates)
+                {
+                    if (!PassesExpansionLimitFilter(bot, candidate->itemId))
+                        continue;
 
-        float const scaled = static_cast<float>(gearScoreLimit) * static_cast<float>(targetIlvl) / static_cast<float>(currentIlvl);
-        uint32 nextLimit = static_cast<uint32>(scaled);
+                    ItemTemplate const* proto = sObjectMgr->GetItemTemplate(candidate->itemId);
+                    if (!proto || proto->Duration != 0 || proto->Bonding == BIND_QUEST_ITEM)
+                        continue;
 
-        if (nextLimit == gearScoreLimit)
-        {
-            if (currentIlvl > targetIlvl && nextLimit > 1)
-                --nextLimit;
-            else if (currentIlvl < targetIlvl)
-                ++nextLimit;
+                    if (slot == EQUIPMENT_SLOT_OFFHAND && bot->getClass() == CLASS_ROGUE && proto->Class != ITEM_CLASS_WEAPON)
+                        continue;
+
+                    if (!CouldEquipItem(capabilities, slot, proto))
+                        continue;
+
+                    steps.emplace_back(PlayerbotFactory::CalcMixedGearScore(proto->ItemLevel, proto->Quality), proto->ItemLevel);
+                }
+            }
         }
 
-        gearScoreLimit = std::max<uint32>(1, nextLimit);
+        if (steps.empty())
+            continue;
+
+        /* Sort by limit, then keep only the points where the best ilvl goes up. */
+
+        std::sort(steps.begin(), steps.end());
+        GearLimitSteps rising;
+        for (auto const& step : steps)
+            if (rising.empty() || step.second > rising.back().second)
+                rising.push_back(step);
+
+        slotSteps.push_back(std::move(rising));
+    }
+
+    return slotSteps;
+}
+
+float PredictAverageIlvlForLimit(std::vector<GearLimitSteps> const& slotSteps, uint32 gearScoreLimit)
+{
+    if (slotSteps.empty())
+        return 0.0f;
+
+    uint32 total = 0;
+    for (GearLimitSteps const& steps : slotSteps)
+    {
+        auto const above = std::upper_bound(steps.begin(), steps.end(), gearScoreLimit,
+                                            [](uint32 limit, std::pair<uint32, uint32> const& step) { return limit < step.first; });
+        if (above != steps.begin())
+            total += std::prev(above)->second;
+    }
+
+    return static_cast<float>(total) / static_cast<float>(slotSteps.size());
+}
+
+uint32 SolveSpecPlayerGearScoreLimit(Player* player, float targetAverageIlvl, ModuleConfig const& config)
+{
+    uint32 const fallbackLimit = ComputeGearScoreLimitFromAverageIlvl(targetAverageIlvl);
+    std::vector<GearLimitSteps> const slotSteps =
+        BuildGearLimitSteps(player, config.specPlayerGearQualityCap, config.specPlayerGearLevelSearchWindow);
+    if (slotSteps.empty())
+        return fallbackLimit;
+
+    uint32 high = 1;
+    for (GearLimitSteps const& steps : slotSteps)
+        high = std::max(high, steps.back().first);
+
+    /* Smallest limit whose prediction reaches the target... */
+
+    uint32 low = 1;
+    while (low < high)
+    {
+        uint32 const mid = low + (high - low) / 2;
+        if (PredictAverageIlvlForLimit(slotSteps, mid) >= targetAverageIlvl)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    /* ...unless stopping one step short lands closer to it. */
+
+    if (low > 1)
+    {
+        float const overshoot = PredictAverageIlvlForLimit(slotSteps, low) - targetAverageIlvl;
+        float const undershoot = targetAverageIlvl - PredictAverageIlvlForLimit(slotSteps, low - 1);
+        if (undershoot < std::fabs(overshoot))
+            --low;
     }
+
+    return low;
+}
+
+void ApplySpecPlayerGear(Player* player, uint8 targetLevel, ModuleConfig const& config)
+{
+    float const targetAverageIlvl = static_cast<float>(GetSpecPlayerTargetAverageIlvl(targetLevel, config));
+    uint32 const gearScoreLimit = SolveSpecPlayerGearScoreLimit(player, targetAverageIlvl, config);
+
+    NoteGearAttempt();
+
+    /* Specplayer should stay in green/blue/purple bands and also correct
+     * individual outlier slots toward the requested average ilvl.
+     */
+    RunGearPass(player, gearScoreLimit, config.specPlayerGearQualityCap, targetAverageIlvl, config, true,
+                config.specPlayerGearLevelSearchWindow);
 }
 
 
@@ -4798,31 +7670,59 @@ bool ApplySpecPlayerSetup(Player* target, std::string const& requestedProfile, u
         return false;
     }
 
-    target->CombatStop(true);
-    target->GiveLevel(targetLevel);
-    target->InitTalentForLevel();
-    target->SetUInt32Value(PLAYER_XP, 0);
+    ScopedCommandTrace const commandTrace("specplayer", target);
 
-    ExpansionCap const cap = ResolveExpansionCap(target, config);
-    if (!ApplySpecTalents(target, specNo, cap))
+    ExpansionCap cap = ExpansionCap::Wrath;
     {
-        errorMessage = "failed to apply spec for " + target->GetName() + '.';
-        return false;
+        ScopedStageTimer const stageTimer(CommandStage::Talents);
+        target->CombatStop(true);
+        target->GiveLevel(targetLevel);
+        target->InitTalentForLevel();
+        target->SetUInt32Value(PLAYER_XP, 0);
+
+        cap = ResolveExpansionCap(target, config);
+        if (!ApplySpecTalents(target, specNo, cap))
+        {
+            errorMessage = "failed to apply spec for " + target->GetName() + '.';
+            return false;
+        }
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Maintenance);
+        RunSpecPlayerPostSpecMaintenance(target, cap, config);
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Spells);
+        LearnSpellsForCurrentLevel(target);
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Skills);
+        if (config.specPlayerApplyPrimaryProfessions)
+            ApplyRequestedPrimaryProfessions(target, professions);
+        if (config.specPlayerNormalizeKnownSkills)
+            NormalizeKnownSkillsToLevelCap(target);
+    }
+
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Mounts);
+        if (config.specPlayerRemoveLevel60EpicClassMountSpells)
+            RemoveLevel60EpicClassMountSpellsForSpecPlayer(target);
+        NormalizeSpecPlayerRidingForLevel(target, config);
     }
 
-    RunSpecPlayerPostSpecMaintenance(target, cap, config);
-    LearnSpellsForCurrentLevel(target);
-    if (config.specPlayerApplyPrimaryProfessions)
-        ApplyRequestedPrimaryProfessions(target, professions);
-    if (config.specPlayerNormalizeKnownSkills)
-        NormalizeKnownSkillsToLevelCap(target);
-    if (config.specPlayerRemoveLevel60EpicClassMountSpells)
-        RemoveLevel60EpicClassMountSpellsForSpecPlayer(target);
-    NormalizeSpecPlayerRidingForLevel(target, config);
-    ApplySpecPlayerGear(target, targetLevel, config);
+    {
+        ScopedStageTimer const stageTimer(CommandStage::Gear);
+        ApplySpecPlayerGear(target, targetLevel, config);
+    }
 
     if (PlayerbotAI* botAI = GET_PLAYERBOT_AI(target))
+    {
+        ScopedStageTimer const stageTimer(CommandStage::AIReset);
         ResetBotAIAndActions(botAI);
+    }
 
     appliedCanonical = resolved.definition->canonical;
     return true;
@@ -4839,7 +7739,8 @@ void ProcessOfflineSpecPlayerOnLogin(Player* player)
     if (!LoadOfflineSpecPlayerRequest(player->GetGUID().GetCounter(), canonicalSpec, targetLevel, professions))
         return;
 
-    ModuleConfig const config = LoadModuleConfig();
+    std::shared_ptr<ModuleConfig const> const configSnapshot = GetModuleConfig();
+    ModuleConfig const& config = *configSnapshot;
     if (!config.enabled)
         return;
 
@@ -4865,21 +7766,22 @@ void ProcessOfflineSpecPlayerOnLogin(Player* player)
     }
 
     uint32 const currentAvgIlvl = static_cast<uint32>(player->GetAverageItemLevelForDF());
+    uint32 const targetAvgIlvl = GetSpecPlayerTargetAverageIlvl(targetLevel, config);
     if (professions.first != 0 && professions.second != 0)
     {
-        handler.PSendSysMessage("specplayer: pending offline setup applied -> level {}, spec '{}', professions '{} + {}', current average ilvl {}.",
+        handler.PSendSysMessage("specplayer: pending offline setup applied -> level {}, spec '{}', professions '{} + {}', current average ilvl {} (target {}).",
                                 uint32(player->GetLevel()),
                                 FormatCanonicalName(appliedCanonical),
                                 ProfessionSkillToName(professions.first),
                                 ProfessionSkillToName(professions.second),
-                                currentAvgIlvl);
+                                currentAvgIlvl, targetAvgIlvl);
     }
     else
     {
-        handler.PSendSysMessage("specplayer: pending offline setup applied -> level {}, spec '{}', current average ilvl {}.",
+        handler.PSendSysMessage("specplayer: pending offline setup applied -> level {}, spec '{}', current average ilvl {} (target {}).",
                                 uint32(player->GetLevel()),
                                 FormatCanonicalName(appliedCanonical),
-                                currentAvgIlvl);
+                                currentAvgIlvl, targetAvgIlvl);
     }
 }
 
@@ -4893,14 +7795,56 @@ public:
 
     Acore::ChatCommands::ChatCommandTable GetCommands() const override
     {
+        static Acore::ChatCommands::ChatCommandTable betterSetupCommandTable =
+        {
+            { "stats", HandleBetterSetupStatsCommand, SEC_GAMEMASTER, Acore::ChatCommands::Console::Yes }
+        };
+
         static Acore::ChatCommands::ChatCommandTable commandTable =
         {
-            { "specplayer", HandleSpecPlayerCommand, SEC_PLAYER, Acore::ChatCommands::Console::Yes }
+            { "specplayer", HandleSpecPlayerCommand, SEC_PLAYER, Acore::ChatCommands::Console::Yes },
+            { "bettersetup", betterSetupCommandTable }
         };
 
         return commandTable;
     }
 
+    /* Print per-stage latency since the last call, then start a fresh window. */
+
+    static bool HandleBetterSetupStatsCommand(ChatHandler* handler)
+    {
+        if (!handler)
+            return false;
+
+        std::map<std::string, CommandStageStats>& stats = GetCommandStageStats();
+        if (stats.empty())
+        {
+            handler->SendSysMessage("bettersetup stats: no samples recorded since the last reset.");
+            return true;
+        }
+
+        handler->SendSysMessage("bettersetup stats: command.stage count p50 / p95 / p99 / max (ms)");
+
+        for (auto& [command, stages] : stats)
+        {
+            for (size_t stage = 0; stage < COMMAND_STAGE_COUNT; ++stage)
+            {
+                StageStats& stageStats = stages[stage];
+                if (!stageStats.count)
+                    continue;
+
+                std::vector<uint32>& samples = stageStats.samplesUs;
+                handler->PSendSysMessage("{}.{} {} {:.1f} / {:.1f} / {:.1f} / {:.1f}", command,
+                                         CommandStageToString(static_cast<CommandStage>(stage)), stageStats.count,
+                                         StageSamplePercentile(samples, 50) / 1000.0, StageSamplePercentile(samples, 95) / 1000.0,
+                                         StageSamplePercentile(samples, 99) / 1000.0, stageStats.maxUs / 1000.0);
+            }
+        }
+
+        stats.clear();
+        return true;
+    }
+
     static bool HandleSpecPlayerCommand(ChatHandler* handler, Acore::ChatCommands::PlayerIdentifier targetIdentifier,
                                         std::string specProfile, uint32 requestedLevel,
                                         Optional<std::string> skill1Arg,
@@ -4909,7 +7853,8 @@ public:
         if (!handler)
             return false;
 
-        ModuleConfig const config = LoadModuleConfig();
+        std::shared_ptr<ModuleConfig const> const configSnapshot = GetModuleConfig();
+        ModuleConfig const& config = *configSnapshot;
         if (!config.enabled)
         {
             handler->SendSysMessage("specplayer: module is disabled (PlayerbotBetterSetup.Spec.Enable = 0).");
@@ -5027,23 +7972,24 @@ public:
         }
 
         uint32 const currentAvgIlvl = static_cast<uint32>(target->GetAverageItemLevelForDF());
+        uint32 const targetAvgIlvl = GetSpecPlayerTargetAverageIlvl(targetLevel, config);
         if (requestedProfessions.first != 0 && requestedProfessions.second != 0)
         {
-            handler->PSendSysMessage("specplayer: {} -> level {}, spec '{}', professions '{} + {}', current average ilvl {}.",
+            handler->PSendSysMessage("specplayer: {} -> level {}, spec '{}', professions '{} + {}', current average ilvl {} (target {}).",
                                      target->GetName(),
                                      uint32(target->GetLevel()),
                                      FormatCanonicalName(appliedCanonical),
                                      ProfessionSkillToName(requestedProfessions.first),
                                      ProfessionSkillToName(requestedProfessions.second),
-                                     currentAvgIlvl);
+                                     currentAvgIlvl, targetAvgIlvl);
         }
         else
         {
-            handler->PSendSysMessage("specplayer: {} -> level {}, spec '{}', current average ilvl {}.",
+            handler->PSendSysMessage("specplayer: {} -> level {}, spec '{}', current average ilvl {} (target {}).",
                                      target->GetName(),
                                      uint32(target->GetLevel()),
                                      FormatCanonicalName(appliedCanonical),
-                                     currentAvgIlvl);
+                                     currentAvgIlvl, targetAvgIlvl);
         }
         return true;
     }
@@ -5056,7 +8002,8 @@ void SendLoginDiagnostics(Player* player)
     if (!player || !player->GetSession())
         return;
 
-    ModuleConfig const config = LoadModuleConfig();
+    std::shared_ptr<ModuleConfig const> const configSnapshot = GetModuleConfig();
+    ModuleConfig const& config = *configSnapshot;
     if (!config.loginDiagnosticsEnable)
         return;
 
@@ -5114,9 +8061,47 @@ public:
 
     void OnPlayerLogin(Player* player) override
     {
+        TrackRandomBotLogin(player);
         ProcessOfflineSpecPlayerOnLogin(player);
         SendLoginDiagnostics(player);
     }
+
+    void OnPlayerLogout(Player* player) override
+    {
+        TrackRandomBotLogout(player);
+        ForgetCurrentSpec(player);
+        ForgetSpellWatermark(player);
+    }
+};
+
+/* Config reload hook republishes the snapshot the chat hooks read and drops
+ * cached item scores, gear plans and talent tables; the update hook drains queued bot commands within the tick budget.
+ */
+
+class PlayerbotBetterSetupWorldScript final : public WorldScript
+{
+public:
+    PlayerbotBetterSetupWorldScript()
+        : WorldScript("PlayerbotBetterSetupWorldScript", { WORLDHOOK_ON_AFTER_CONFIG_LOAD, WORLDHOOK_ON_UPDATE })
+    {
+    }
+
+    void OnAfterConfigLoad(bool /*reload*/) override
+    {
+        PublishModuleConfig();
+        ClearItemScoreCache();
+        ClearGearPlanCache();
+        ClearTalentTemplateTables();
+        ClearSpecNoTables();
+        ClearCurrentSpecCache();
+        ClearTrainerSpellManifests();
+        BumpSpellManifestVersion();
+    }
+
+    void OnUpdate(uint32 /*diff*/) override
+    {
+        DrainCommandJobs(GetModuleConfig()->schedulerTickBudgetMs);
+    }
 };
 
 class PlayerbotBetterSetupPlayerScript final : public PlayerScript
@@ -5146,7 +8131,7 @@ public:
 
     bool OnPlayerCanUseChat(Player* player, uint32 type, uint32 /*language*/, std::string& msg, Player* receiver) override
     {
-        if (!player || !receiver)
+        if (!player || !receiver || !ShouldInspectChatMessage(msg))
             return true;
 
         if (!GET_PLAYERBOT_AI(receiver))
@@ -5160,7 +8145,7 @@ public:
 
     bool OnPlayerCanUseChat(Player* player, uint32 type, uint32 /*language*/, std::string& msg, Group* group) override
     {
-        if (!player || !group)
+        if (!player || !group || !ShouldInspectChatMessage(msg))
             return true;
 
         ProcessTargets(player, type, msg, CollectGroupBots(group));
@@ -5171,7 +8156,7 @@ public:
 
     bool OnPlayerCanUseChat(Player* player, uint32 type, uint32 /*language*/, std::string& msg, Guild* guild) override
     {
-        if (!player || !guild || type != CHAT_MSG_GUILD)
+        if (!player || !guild || type != CHAT_MSG_GUILD || !ShouldInspectChatMessage(msg))
             return true;
 
         ProcessTargets(player, type, msg, CollectGuildBots(player));
@@ -5182,7 +8167,7 @@ public:
 
     bool OnPlayerCanUseChat(Player* player, uint32 type, uint32 /*language*/, std::string& msg, Channel* channel) override
     {
-        if (!player || !channel)
+        if (!player || !channel || !ShouldInspectChatMessage(msg))
             return true;
 
         ProcessTargets(player, type, msg, CollectChannelBots(player, channel));
@@ -5197,4 +8182,5 @@ void AddPlayerbotBetterSetupScripts()
     new PlayerbotBetterSetupCommandScript();
     new PlayerbotBetterSetupLoginScript();
     new PlayerbotBetterSetupPlayerScript();
+    new PlayerbotBetterSetupWorldScript();
 }